@@ -0,0 +1,28 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_INITIAL_BLOCK_SIZE 512
+#define ARENA_MAX_BLOCK_SIZE 16384
+// Every piece starts at a multiple of this, so any type can be stored in it
+#define ARENA_ALIGNMENT 16
+
+typedef struct ArenaBlock ArenaBlock;
+
+// Memory that is handed out in small pieces and freed all at once.
+// The pieces can't be freed by themselves, their memory is only given back when the whole arena is freed.
+// An arena that is all zeros is empty, and moving it somewhere else is just copying the struct.
+typedef struct {
+    ArenaBlock* blocks;
+} Arena;
+
+// Returns zeroed memory that lives until the arena is freed, or NULL if it runs out of memory.
+void* arena_alloc(Arena* arena, size_t size);
+// Copies the string into the arena.
+char* arena_strdup(Arena* arena, const char* string);
+// How many bytes the arena took from the system.
+size_t arena_get_size(const Arena* arena);
+void arena_free(Arena* arena);
+
+#endif
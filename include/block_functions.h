@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "byte_buffer.h"
 #include "item_container.h"
 #include "chunk.h"
 #include "types.h"
@@ -26,14 +27,14 @@ typedef void (*BlockDestroyCallback)(BlockExtraResult result, ChunkLayerEnum lay
 typedef bool (*BlockTickCallback)(BlockExtraResult result, BlockExtraResult other, BlockExtraResult neighbors[4], ChunkLayerEnum layer);
 // Function that draws anything on the top of a block based on the block's external data.
 typedef void (*BlockOverlayRender)(void* data, Vector2 position, uint8_t state);
-// Function for freeing up any block data.
+// Function for cleaning up block data that needs more than its memory given back (which the chunk does on its own).
 typedef void (*BlockFreeData)(void* data);
 // Function that returns the current data size.
 typedef uint32_t (*BlockDataSize)(void* data);
-// Function for serializing data (eg. to a file).
-typedef void (*BlockSerializeData)(void* data, FILE* fptr);
-// Function for deserializing data (eg. from a file). Returns a pointer to the newly allocated serialized data.
-typedef void* (*BlockDeserializeData)(FILE* fptr);
+// Function for serializing data (eg. to a file). It must write exactly as many bytes as the data size function returns.
+typedef void (*BlockSerializeData)(void* data, ByteWriter* writer);
+// Function for deserializing data (eg. from a file). Returns a pointer to the data, allocated from the arena of the chunk layer.
+typedef void* (*BlockDeserializeData)(ByteReader* reader, Arena* arena);
 
 bool grounded_block_resolver(BlockExtraResult result, BlockExtraResult other, BlockExtraResult neighbors[4], ChunkLayerEnum layer);
 bool plant_block_resolver(BlockExtraResult result, BlockExtraResult other, BlockExtraResult neighbors[4], ChunkLayerEnum layer);
@@ -56,16 +57,13 @@ bool water_flowing_tick(BlockExtraResult result, BlockExtraResult other, BlockEx
 
 void sign_text_draw(void* data, Vector2 position, uint8_t state);
 
-void chest_free_data(void* data);
-void sign_free_data(void* data);
-
 uint32_t chest_data_size(void* data);
 uint32_t sign_data_size(void* data);
 
-void chest_serialize_data(void* data, FILE* fptr);
-void sign_serialize_data(void* data, FILE* fptr);
+void chest_serialize_data(void* data, ByteWriter* writer);
+void sign_serialize_data(void* data, ByteWriter* writer);
 
-void* chest_deserialize_data(FILE* fptr);
-void* sign_deserialize_data(FILE* fptr);
+void* chest_deserialize_data(ByteReader* reader, Arena* arena);
+void* sign_deserialize_data(ByteReader* reader, Arena* arena);
 
 #endif
\ No newline at end of file
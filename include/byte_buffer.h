@@ -0,0 +1,44 @@
+#ifndef BYTE_BUFFER_H
+#define BYTE_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BYTE_WRITER_INITIAL_CAPACITY 4096
+
+// Growable buffer that things are serialized into, so they can be written to a file all at once.
+// Values are stored in the native byte order, the same way fwrite would store them.
+// If it runs out of memory, it stops writing and sets failed, so the checking can be left to the end.
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+} ByteWriter;
+
+// Reads values back from a buffer. Reading past the end fills the values with zeros and sets failed.
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t position;
+    bool failed;
+} ByteReader;
+
+// Empties the writer, keeping the memory it already has.
+void byte_writer_clear(ByteWriter* writer);
+void byte_writer_write(ByteWriter* writer, const void* data, size_t size);
+void byte_writer_write_u8(ByteWriter* writer, uint8_t value);
+void byte_writer_write_u16(ByteWriter* writer, uint16_t value);
+void byte_writer_write_u32(ByteWriter* writer, uint32_t value);
+void byte_writer_free(ByteWriter* writer);
+
+ByteReader byte_reader_create(const uint8_t* data, size_t size);
+bool byte_reader_read(ByteReader* reader, void* out, size_t size);
+uint8_t byte_reader_read_u8(ByteReader* reader);
+uint16_t byte_reader_read_u16(ByteReader* reader);
+uint32_t byte_reader_read_u32(ByteReader* reader);
+// Moves to the given position, counting from the start of the buffer.
+bool byte_reader_seek(ByteReader* reader, size_t position);
+
+#endif
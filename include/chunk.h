@@ -22,6 +22,16 @@ typedef enum {
 	NEIGHBOR_BOTTOM_LEFT = 7
 } NeighborDirection;
 
+// Where a chunk is on its way from being requested to being drawn.
+typedef enum {
+	// The blocks are still being loaded or generated by a worker thread.
+	// Until then the chunk is empty, and it doesn't take part on lighting or block changes.
+	CHUNK_STATE_REQUESTED = 0,
+	CHUNK_STATE_LOADED,
+	CHUNK_STATE_LIT,
+	CHUNK_STATE_MESHED
+} ChunkState;
+
 typedef struct {
 	void* up;
 	void* right;
@@ -34,19 +44,60 @@ typedef struct {
 	void* downRight;
 } ChunkNeighbors;
 
+#define CHUNK_MESH_INPUT_WIDTH (CHUNK_WIDTH + 2)
+
+// What a chunk mesh was built from: the blocks and light of the chunk with a border of one cell from its neighbors,
+// and the settings that change how the blocks look. A block only looks at the cells around it,
+// so comparing these with the current ones tells which cells have to be meshed again.
+typedef struct {
+	uint8_t light[CHUNK_MESH_INPUT_WIDTH * CHUNK_MESH_INPUT_WIDTH];
+	uint8_t ids[CHUNK_LAYER_COUNT][CHUNK_MESH_INPUT_WIDTH * CHUNK_MESH_INPUT_WIDTH];
+	uint8_t states[CHUNK_LAYER_COUNT][CHUNK_MESH_INPUT_WIDTH * CHUNK_MESH_INPUT_WIDTH];
+	Vector2i position;
+	uint8_t wallBrightness;
+	uint8_t wallAoBrightness;
+	bool smoothLighting;
+	bool wallAo;
+	bool valid;
+} ChunkMeshInputs;
+
+// Everything a chunk needs to be drawn. It's only used by the main thread when drawing or applying meshes,
+// so it's kept apart from the blocks and light, which are what most of the code goes through.
+typedef struct {
+	ChunkLayerMesh layers[CHUNK_LAYER_COUNT];
+	// Only created once the chunk has liquids to show, most chunks never need it.
+	Mesh liquidMesh;
+	bool initializedLiquidMesh;
+	// What the layer meshes were built from. Not valid until the chunk is meshed for the first time.
+	ChunkMeshInputs meshInputs;
+} ChunkRender;
+
 typedef struct {
 	ChunkLayer layers[2];
+	// Only has memory allocated when there are blocks to tick.
 	BlockTickList blockTickList;
     uint8_t light[CHUNK_AREA];
-	Mesh liquidMesh;
 	ChunkNeighbors neighbors;
 	Vector2i position;
-	bool initializedLiquidMesh;
+	// NULL on snapshots, and on chunks that haven't been initialized.
+	ChunkRender* render;
 	bool initialized;
+	ChunkState state;
+	// Identifies the last load job submitted for this chunk, so the results of older ones are ignored.
+	unsigned int loadRequest;
+	// The chunk has changed and needs to have its mesh regenerated.
+	bool meshDirty;
+	// Every block of both layers was the same (like chunks of sky or deep underground) when the chunk was loaded,
+	// and none of them changed since. Such chunks are lit and meshed without going through every block.
+	bool uniform;
+	// A block (or its data) changed since the chunk was loaded or last saved.
+	// Chunks that aren't modified are already on the disk, or can be generated again, so they aren't saved.
+	bool modified;
 } Chunk;
 
 typedef struct {
-	BlockInstance* block;
+	// block.id is NULL when there is no block.
+	BlockRef block;
 	// Pointer to the block registry.
 	// couldn't include the actual type because of stupid
 	// circular dependency.
@@ -67,9 +118,26 @@ typedef struct {
 	BlockExtraResult down;
 } DownProjectionResult;
 
+// Everything needed to update the meshes of a chunk.
+typedef struct {
+	ChunkLayerMeshData layers[CHUNK_LAYER_COUNT];
+	// The layers are partial when they were built on top of a previous mesh (base), and they only fit that mesh.
+	ChunkMeshInputs base;
+	ChunkMeshInputs inputs;
+	float liquidVertices[CHUNK_VERTEX_COUNT * 3];
+	unsigned char liquidColors[CHUNK_VERTEX_COUNT * 4];
+	bool hasLiquids;
+} ChunkMeshData;
+
 void chunk_init(Chunk* chunk, Vector2i position);
 void chunk_regenerate(Chunk* chunk);
 void chunk_genmesh(Chunk* chunk);
+// Builds the mesh buffers without touching the GPU. It only reads from the chunk and its neighbors,
+// so it can run on a worker thread as long as it's given a snapshot.
+// If previous is what the current mesh was built from, only the cells that changed since are generated.
+bool chunk_build_mesh_data(Chunk* chunk, const ChunkMeshInputs* previous, ChunkMeshData* out);
+// Must run on the main thread. If partial data doesn't fit the current mesh anymore, the chunk is marked to be meshed again.
+void chunk_apply_mesh_data(Chunk* chunk, ChunkMeshData* data);
 void chunk_update_tick_list(Chunk* chunk);
 void chunk_draw(Chunk* chunk);
 void chunk_draw_liquids(Chunk* chunk);
@@ -78,7 +146,21 @@ void chunk_tick(Chunk* chunk, uint8_t tick_value);
 void chunk_free_meshes(Chunk* chunk);
 void chunk_free_block_data(Chunk* chunk);
 
+// Light engine. Light is spread with a BFS over queued cells instead of recursion.
+// Cells are queued with chunk_queue_light (brightening) or chunk_queue_light_removal (darkening),
+// and chunk_propagate_light processes both queues across chunk borders.
+uint8_t chunk_get_light_source(Chunk* chunk, Vector2u position);
+void chunk_queue_light(Chunk* chunk, Vector2u position, uint8_t value);
+void chunk_queue_light_removal(Chunk* chunk, Vector2u position);
+void chunk_propagate_light();
 void chunk_fill_light(Chunk* chunk, Vector2u startPoint, uint8_t newLightValue);
+// Lights a uniform chunk without going through every cell: all of them get the light of the block,
+// and only the cells on the borders are queued, along with the cells around the chunk so their light comes in.
+void chunk_queue_uniform_light(Chunk* chunk);
+// Recomputes the light around a cell after the blocks on it have changed.
+void chunk_update_light(Chunk* chunk, Vector2u position);
+void chunk_free_light_queues();
+
 bool chunk_solve_block(Chunk* chunk, Vector2u position, ChunkLayerEnum layer);
 void chunk_propagate_power_wire(Chunk* chunk, Vector2u startPoint, ChunkLayerEnum layer, uint8_t newPowerValue);
 void chunk_propagate_remove_power_wire(Chunk* chunk, Vector2u point, ChunkLayerEnum layer);
@@ -91,8 +173,8 @@ DownProjectionResult chunk_get_block_projected_downwards(Chunk* chunk, Vector2u
 // if it is, it will return the block relative to that chunk.
 // Otherwise, it will get the block from a neighboring chunk.
 
-// Pointer getter functions
-BlockInstance* chunk_get_block_ptr(Chunk* chunk, Vector2u position, ChunkLayerEnum layer);
+// Pointer getter functions. The id of the returned BlockRef is NULL if there is no block there.
+BlockRef chunk_get_block_ptr(Chunk* chunk, Vector2u position, ChunkLayerEnum layer);
 BlockExtraResult chunk_get_block_extrapolating_ptr(Chunk* chunk, Vector2i position, ChunkLayerEnum layer);
 uint8_t* chunk_get_light_ptr(Chunk* chunk, Vector2u position);
 LightExtraResult chunk_get_light_extrapolating_ptr(Chunk* chunk, Vector2i position);
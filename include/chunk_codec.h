@@ -0,0 +1,49 @@
+#ifndef CHUNK_CODEC_H
+#define CHUNK_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chunk_layer.h"
+#include "types.h"
+
+// Compact encoding of the blocks of a chunk (both layers), without their data.
+//
+// It starts with a palette of the distinct id and state pairs, followed by the palette index of every block,
+// covering the background layer and then the foreground layer:
+//
+//     uint8 mode, uint16 palette count (little endian), then (uint8 id, uint8 state) for every palette entry
+//
+// With CHUNK_CODEC_RUNS, the indices come as runs:
+//
+//     (uint8 run length - 1, palette index) until every block is covered
+//
+// where the palette index is one byte when the palette has up to 256 entries, and two bytes (little endian) otherwise.
+// With CHUNK_CODEC_PACKED, every index takes just enough bits for the palette, packed from the lowest bit of each byte.
+//
+// The encoder picks whichever is smaller. Most chunks are a handful of runs of stone, dirt and air,
+// so they end up with a few dozen bytes.
+//
+// These functions don't touch any global state, so they can be used from any thread.
+
+#define CHUNK_CODEC_BLOCK_COUNT (CHUNK_AREA * CHUNK_LAYER_COUNT)
+// Biggest possible encoding: a palette with every block different and a run for each of them
+#define CHUNK_CODEC_MAX_SIZE (3 + CHUNK_CODEC_BLOCK_COUNT * 2 + CHUNK_CODEC_BLOCK_COUNT * 3)
+
+#define CHUNK_CODEC_RUNS 0
+#define CHUNK_CODEC_PACKED 1
+
+// Encodes the blocks into out, which must have room for CHUNK_CODEC_MAX_SIZE bytes.
+// Returns how many bytes were written.
+size_t chunk_codec_encode(const ChunkLayer layers[CHUNK_LAYER_COUNT], uint8_t* out);
+
+// Decodes the ids and states of the blocks into the layers. The data lists of the layers are left as they are.
+// Returns false if the encoding is malformed.
+bool chunk_codec_decode(const uint8_t* in, size_t size, ChunkLayer layers[CHUNK_LAYER_COUNT]);
+
+// Returns true if every block of both layers has the same id and state and none of them have data.
+// The block is written to out.
+bool chunk_codec_is_uniform(const ChunkLayer layers[CHUNK_LAYER_COUNT], BlockInstance* out);
+
+#endif
@@ -5,22 +5,98 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "arena.h"
 #include "types.h"
 
-#define CHUNK_VERTEX_COUNT CHUNK_AREA * 6
+#define CHUNK_VERTEX_COUNT (CHUNK_AREA * 6)
 
 typedef struct {
-    BlockInstance blocks[CHUNK_AREA];
+    uint8_t idx;
+    void* data;
+} BlockDataEntry;
+
+// The ids and states of the blocks are kept in their own arrays, so going through the blocks only reads 2 bytes per block.
+// Only a few blocks (like chests and signs) have data, so it's kept in a small list instead of on every block.
+// The data itself is allocated from the arena of the layer, so it's all freed at once when the chunk goes away.
+// Removed data stays in the arena until there is more of it than data in use, then the data in use is copied to a new arena.
+typedef struct {
+    uint8_t ids[CHUNK_AREA];
+    uint8_t states[CHUNK_AREA];
+    BlockDataEntry* data;
+    int dataCount;
+    int dataCapacity;
+    Arena arena;
+    // How many pieces of data were removed (or replaced) since the arena was made
+    int deadData;
+} ChunkLayer;
+
+// The GPU side of a layer. It's kept apart from the blocks, so the block data stays small
+// and code that only goes through the blocks doesn't have to pull the meshes into the cache.
+typedef struct {
     size_t vertexOffsets[CHUNK_AREA];
     Mesh mesh;
     bool initializedMesh;
-} ChunkLayer;
+} ChunkLayerMesh;
+
+// Points to a block inside a layer, the same way a BlockInstance* would.
+// The id and state can be changed through it, but the data has to go through block_ref_get_data and block_ref_set_data.
+typedef struct {
+    uint8_t* id;
+    uint8_t* state;
+    ChunkLayer* layer;
+    uint8_t idx;
+} BlockRef;
+
+// CPU side buffers of a layer mesh.
+// They can be built on any thread, but only the main thread can apply them to the mesh.
+typedef struct {
+    size_t vertexOffsets[CHUNK_AREA];
+    int vertexCount;
+    float* vertices;
+    float* texcoords;
+    unsigned char* colors;
+    // Only the cells set in the mask were generated. The other cells are left for the current mesh to fill,
+    // and the buffers are NULL when no cell was generated.
+    bool partial;
+    uint32_t cells[CHUNK_AREA / 32];
+} ChunkLayerMeshData;
 
 void chunk_layer_init(ChunkLayer* layer);
-void chunk_layer_genmesh(ChunkLayer* layer, ChunkLayerEnum layer_id, ChunkLayerEnum front_layer_id, void* c, unsigned int chunk_pos_seed, uint8_t brightness);
-void chunk_layer_draw(ChunkLayer* layer);
+void chunk_layer_genmesh(ChunkLayer* layer, ChunkLayerMesh* mesh, ChunkLayerEnum layer_id, ChunkLayerEnum front_layer_id, void* c, unsigned int chunk_pos_seed, uint8_t brightness);
+
+// Only reads from the layer and the chunk, so it's safe to call on a snapshot from a worker thread.
+// If cells isn't NULL, only the cells set in it are generated.
+bool chunk_layer_build_mesh_data(ChunkLayer* layer, ChunkLayerEnum layer_id, ChunkLayerEnum front_layer_id, void* c, unsigned int chunk_pos_seed, uint8_t brightness, const uint32_t* cells, ChunkLayerMeshData* out);
+// Uploads the data to the mesh, only sending the parts that changed when possible.
+// The data buffers are either taken by the mesh or freed.
+// Returns false if partial data didn't fit the current mesh, which is then left as it was.
+bool chunk_layer_apply_mesh_data(ChunkLayerMesh* mesh, ChunkLayerMeshData* data);
+void chunk_layer_free_mesh_data(ChunkLayerMeshData* data);
+void chunk_layer_draw(ChunkLayer* layer, ChunkLayerMesh* mesh);
+
+BlockInstance chunk_layer_get_block(const ChunkLayer* layer, int idx);
+// Sets the id, state and data of the block. The data it had before isn't freed.
+void chunk_layer_set_block(ChunkLayer* layer, int idx, BlockInstance block);
+void* chunk_layer_get_data(const ChunkLayer* layer, int idx);
+// Setting the data to NULL takes the block out of the data list. The data it had before isn't freed,
+// but once no block has data anymore, the arena of the layer is emptied.
+bool chunk_layer_set_data(ChunkLayer* layer, int idx, void* data);
+// Allocates zeroed memory for block data that lives as long as the layer keeps its data.
+void* chunk_layer_alloc_data(ChunkLayer* layer, size_t size);
+BlockRef chunk_layer_get_ref(ChunkLayer* layer, int idx);
+
+BlockInstance block_ref_get(BlockRef ref);
+void* block_ref_get_data(BlockRef ref);
+bool block_ref_set_data(BlockRef ref, void* data);
+void* block_ref_alloc_data(BlockRef ref, size_t size);
 
-void chunk_layer_free_mesh(ChunkLayer* layer);
+void chunk_layer_free_mesh(ChunkLayerMesh* mesh);
+// Calls free_data on the blocks that need it, then frees the arena with the rest of the data.
 void chunk_layer_free_block_data(ChunkLayer* layer);
+// Empties the data list and drops the arena without freeing the data, for when it was moved somewhere else.
+void chunk_layer_forget_block_data(ChunkLayer* layer);
+// Moves the blocks and their data (arena included) from src to dst, leaving src without data.
+// Any data dst had is forgotten, so it should be freed before.
+void chunk_layer_move_blocks(ChunkLayer* dst, ChunkLayer* src);
 
 #endif
\ No newline at end of file
@@ -10,11 +10,60 @@
 #include "item_container.h"
 #include "chunk.h"
 
+typedef struct {
+    int count;
+    // Memory used by the cached chunks and the most it is allowed to use, in bytes
+    size_t bytes;
+    size_t budget;
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int evictions;
+} ChunkCacheStats;
+
 void chunk_manager_init(Vector2i center, uint8_t cvw, uint8_t cvh);
 void chunk_manager_relocate(Vector2i newCenter);
 void chunk_manager_set_view(uint8_t new_view_width, uint8_t new_view_height);
+// Chunks that enter the view are loaded (or generated) by worker threads, so relocating never waits for them.
+// This picks up the chunks that finished loading and lights them. It doesn't block.
+void chunk_manager_update_loading();
+// Waits until every requested chunk is loaded and lit.
+void chunk_manager_finish_loading();
+// Amount of chunks in the view that are still being loaded.
+int chunk_manager_get_loading_count();
+// Starts an autosave when the interval or the amount of unsaved chunks from the settings is reached,
+// and keeps writing the unsaved cached chunks over the next calls. Chunks are serialized here
+// and written by a background thread. Returns true when an autosave starts.
+bool chunk_manager_update_autosave();
+// Copies the world info and writes it on the background thread, once the running autosave
+// queued all of its chunks, so it reaches the disk with them.
+void chunk_manager_save_world_info();
+// Amount of chunk saves waiting to be written by the background thread.
+int chunk_manager_get_saving_count();
 // This function recalculates all lighting in all chunks, and regenerates their meshes.
 void chunk_manager_update_lighting();
+// Marks every loaded chunk to have its mesh regenerated.
+void chunk_manager_remesh();
+// Marks the loaded chunks that overlap the area (in global block coordinates, inclusive) to have their meshes regenerated.
+void chunk_manager_remesh_area(Vector2i start, Vector2i end);
+// Regenerates the meshes of the marked chunks, closest to the center (in world coordinates) first,
+// until the time budget (in seconds) runs out. A budget of zero or less builds all of them.
+void chunk_manager_update_meshes(Vector2 center, double time_budget);
+int chunk_manager_get_dirty_mesh_count();
+// Measures how long it takes to resolve the block variants of the loaded chunks and to mesh them,
+// and prints the results to the log.
+void chunk_manager_benchmark_meshing(int iterations);
+// Compares saving and loading the loaded chunks with one file per chunk and with region files,
+// and prints the results to the log.
+void chunk_manager_benchmark_storage();
+// Relights the blocks inside the area (in global block coordinates, inclusive)
+// and regenerates only the meshes of the chunks the light change can reach.
+void chunk_manager_update_lighting_area(Vector2i start, Vector2i end);
+// Records the cells inside the area (in global block coordinates, inclusive) as changed,
+// without updating anything yet.
+void chunk_manager_mark_dirty_area(Vector2i start, Vector2i end);
+// Applies every recorded change with a single relight pass and marks the affected chunks to be remeshed.
+// While chunk_manager_tick is running, the functions above only record changes and this is called at the end of the tick.
+void chunk_manager_flush_changes();
 void chunk_manager_draw(bool draw_lines);
 void chunk_manager_draw_liquids();
 void chunk_manager_tick();
@@ -24,6 +73,7 @@ void chunk_manager_free();
 uint8_t chunk_manager_get_view_width();
 uint8_t chunk_manager_get_view_height();
 int chunk_manager_get_cached_chunk_count();
+ChunkCacheStats chunk_manager_get_cache_stats();
 
 // Returns true when a interaction occurred, false when not.
 bool chunk_manager_interact(Vector2i position, ChunkLayerEnum layer, ItemSlot holdingItem);
@@ -10,6 +10,11 @@
 
 #define GAME_SETTINGS_FILE_NAME "settings.bin"
 #define GAME_SETTINGS_MAX_CHUNK_VIEW 16
+#define GAME_SETTINGS_MAX_MESH_BUDGET_MS 16
+#define GAME_SETTINGS_MIN_CHUNK_CACHE_MB 8
+#define GAME_SETTINGS_MAX_CHUNK_CACHE_MB 1024
+#define GAME_SETTINGS_MAX_AUTOSAVE_INTERVAL 600
+#define GAME_SETTINGS_MAX_AUTOSAVE_CHUNKS 1024
 
 typedef struct {
 	Color player_color;
@@ -21,6 +26,14 @@ typedef struct {
 	bool drawfps;
 	bool smooth_lighting;
 	bool wall_ao;
+	// How many milliseconds per frame can be spent rebuilding chunk meshes
+	uint8_t mesh_budget_ms;
+	// How much memory the chunks that left the view can use before they start being saved and unloaded
+	uint16_t chunk_cache_mb;
+	// Seconds between autosaves, zero turns it off
+	uint16_t autosave_interval;
+	// How many unsaved chunks start an autosave before the interval, zero turns it off
+	uint16_t autosave_chunks;
 } GameSettings;
 
 // Had to make a separate struct so it can communicate properly with microui
@@ -34,6 +47,10 @@ typedef struct {
 	int drawfps;
 	int smooth_lighting;
 	int wall_ao;
+	float mesh_budget_ms;
+	float chunk_cache_mb;
+	float autosave_interval;
+	float autosave_chunks;
 } TempGameSettings;
 
 void game_settings_to_temp();
@@ -7,6 +7,9 @@
 #include <raylib.h>
 #include <stdio.h>
 
+#include "arena.h"
+#include "byte_buffer.h"
+
 #define ITEM_SLOT_SIZE 42
 #define ITEM_SLOT_GAP 8
 
@@ -28,6 +31,9 @@ typedef struct {
 // Creates a item container with given parameters.
 // the name NEEDS to be a string literal. The container does not free it.
 void item_container_create(ItemContainer* ic, char* name, uint8_t rows, uint8_t columns, bool immutable);
+// Same as item_container_create, but the name is copied and everything is allocated from the arena,
+// so the container must not be given to item_container_free.
+bool item_container_create_in_arena(ItemContainer* ic, Arena* arena, const char* name, uint8_t rows, uint8_t columns, bool immutable);
 ItemSlot item_container_get_item(ItemContainer* ic, uint8_t row, uint8_t column);
 void item_container_set_item(ItemContainer* ic, uint8_t row, uint8_t column, ItemSlot item);
 Vector2 item_container_get_size(ItemContainer* ic);
@@ -38,8 +44,9 @@ void item_container_draw();
 void item_container_free(ItemContainer* ic);
 
 uint32_t item_container_serialized_size(ItemContainer* ic);
-void item_container_serialize(ItemContainer* ic, FILE* fileptr);
-void item_container_deserialize(ItemContainer* ic, FILE* fileptr);
+void item_container_serialize(ItemContainer* ic, ByteWriter* writer);
+// Returns false if the data is truncated or malformed. The name and items are allocated from the arena.
+bool item_container_deserialize(ItemContainer* ic, ByteReader* reader, Arena* arena);
 
 void distribute_item(ItemSlot* item, ItemContainer* container);
 
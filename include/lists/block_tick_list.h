@@ -4,17 +4,30 @@
 #include "types.h"
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-#define TICKS_CAPACITY CHUNK_AREA * 2
+#define BLOCK_TICK_LIST_INITIAL_CAPACITY 8
 
 typedef struct {
     Vector2u position;
     ChunkLayerEnum layer;
 } BlockTickListEntry;
 
+#define BLOCK_TICK_LIST_MAX_COUNT (CHUNK_LAYER_COUNT * CHUNK_AREA)
+
+// Blocks of a chunk that have to be ticked.
+// Most chunks don't have any, so the entries are only allocated once the first one is added,
+// and each one is packed in 2 bytes (the layer and the index of the block).
+// A bit per block tells if it's in the list, and slots tells where, so adding, removing and
+// checking a block doesn't have to go through the whole list.
 typedef struct {
-    BlockTickListEntry entries[TICKS_CAPACITY];
+    uint16_t* entries;
     unsigned int count;
+    unsigned int capacity;
+    uint32_t bits[CHUNK_LAYER_COUNT][CHUNK_AREA / 32];
+    // Position of every block in the entries, only valid when its bit is set
+    uint16_t* slots;
 } BlockTickList;
 
 void block_tick_list_clear(BlockTickList* list);
@@ -24,5 +37,6 @@ bool block_tick_list_remove_by_index(BlockTickList* list, size_t index);
 bool block_tick_list_contains(BlockTickList* list, BlockTickListEntry entry);
 int block_tick_list_count(const BlockTickList* list);
 bool block_tick_list_get(const BlockTickList* list, size_t index, BlockTickListEntry* out);
+void block_tick_list_free(BlockTickList* list);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,38 @@
+#ifndef LIGHT_QUEUE_H
+#define LIGHT_QUEUE_H
+
+#include "types.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LIGHT_QUEUE_INITIAL_CAPACITY (CHUNK_AREA * 4)
+
+typedef struct {
+    // Pointer to the chunk this cell belongs to.
+    // couldn't include the actual type because of
+    // circular dependency.
+    void* chunk;
+    uint8_t idx;
+    // Light value the cell had when it was queued.
+    // Only used by the removal pass.
+    uint8_t value;
+} LightQueueEntry;
+
+// FIFO ring buffer used by the BFS light engine.
+// It grows by itself when it runs out of space, so entries are never dropped.
+typedef struct {
+    LightQueueEntry* entries;
+    size_t head;
+    size_t count;
+    size_t capacity;
+} LightQueue;
+
+void light_queue_clear(LightQueue* queue);
+bool light_queue_push(LightQueue* queue, LightQueueEntry entry);
+bool light_queue_pop(LightQueue* queue, LightQueueEntry* out);
+bool light_queue_is_empty(const LightQueue* queue);
+void light_queue_free(LightQueue* queue);
+
+#endif
@@ -3,12 +3,14 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include <raylib.h>
 
 #include "block_functions.h"
 
 #define MAX_BLOCK_VARIANTS 8
+#define BLOCK_STATE_COUNT 256
 
 typedef enum {
 	BLOCK_AIR,
@@ -167,8 +169,20 @@ typedef struct {
 	uint8_t selectable_states[5];
 } BlockRegistry;
 
+// The variant of a block state with the values derived from it.
+// It's baked for every (block id, state) pair when the registry is initialized,
+// so the hot paths don't have to call the variant generator every time.
+typedef struct {
+	BlockVariant variant;
+	// Amount of vertices of the variant's model.
+	int vertex_count;
+	// Tells if the block doesn't let light pass through.
+	bool opaque;
+} BlockVariantInfo;
+
 void block_registry_init();
 BlockRegistry* br_get_block_registry(size_t idx);
+BlockVariantInfo* br_get_block_variant(uint8_t id, uint8_t state);
 void block_registry_free();
 
 #endif
\ No newline at end of file
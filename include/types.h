@@ -4,7 +4,7 @@
 #define TILE_SIZE 32
 
 #define CHUNK_WIDTH 16
-#define CHUNK_AREA CHUNK_WIDTH*CHUNK_WIDTH
+#define CHUNK_AREA (CHUNK_WIDTH * CHUNK_WIDTH)
 
 #define GAMEPAD_STICK_DEADZONE 0.1f
 
@@ -0,0 +1,52 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stdbool.h>
+
+// Small thread pool used to move heavy CPU work out of the main thread.
+//
+// Every job has a work function, that runs in one of the worker threads,
+// and an optional done function, that runs in the thread that calls worker_pool_poll
+// (usually the main thread). The done function is where the results should be used,
+// like uploading meshes to the GPU, since it's the only place that is safe to touch the game state.
+//
+// This file can't include raylib, because on Windows the thread functions come from windows.h,
+// which conflicts with raylib.
+
+typedef struct WorkerPool WorkerPool;
+typedef void (*WorkerJobFunc)(void* data);
+
+// Creates a pool with the given amount of threads.
+// If the amount is zero or less, it will use one thread less than the amount of CPU cores (at least one).
+// Returns NULL on failure.
+WorkerPool* worker_pool_create(int thread_count);
+
+// Queues a job. Returns false if it couldn't be queued.
+bool worker_pool_submit(WorkerPool* pool, WorkerJobFunc work, WorkerJobFunc done, void* data);
+
+// Runs the done functions of up to max finished jobs (all of them if max is zero or less).
+// Returns how many were run.
+int worker_pool_poll(WorkerPool* pool, int max);
+
+// Amount of jobs that were submitted and still didn't get polled.
+int worker_pool_get_pending_count(WorkerPool* pool);
+int worker_pool_get_thread_count(WorkerPool* pool);
+
+// Blocks until every submitted job has finished running its work function.
+void worker_pool_wait(WorkerPool* pool);
+
+// Waits for every job, runs the pending done functions and stops the threads.
+void worker_pool_destroy(WorkerPool* pool);
+
+int worker_pool_get_cpu_count();
+
+// Plain mutex, for state that is shared between the workers and the main thread.
+typedef struct WorkerMutex WorkerMutex;
+
+// Returns NULL on failure.
+WorkerMutex* worker_mutex_create();
+void worker_mutex_lock(WorkerMutex* mutex);
+void worker_mutex_unlock(WorkerMutex* mutex);
+void worker_mutex_destroy(WorkerMutex* mutex);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef WORLD_MANAGER_H
 #define WORLD_MANAGER_H
 
+#include "byte_buffer.h"
 #include "item_container.h"
 #include "chunk_layer.h"
 
@@ -10,7 +11,7 @@
 #include "types.h"
 
 #define WORLD_NAME_LENGTH 32
-#define WORLD_VERSION 0
+#define WORLD_VERSION 2
 
 typedef enum {
     WORLD_GEN_PRESET_DEFAULT,
@@ -41,6 +42,13 @@ typedef enum {
     CHUNK_LOAD_ERROR_FATAL
 } ChunkLoadStatus;
 
+// A chunk record as it is stored in a region file
+typedef struct {
+    Vector2i position;
+    uint8_t* data;
+    size_t size;
+} RegionRecord;
+
 typedef enum {
     WORLD_RETURN_NONE,
     WORLD_RETURN_CLOSE,
@@ -52,16 +60,59 @@ void world_manager_init();
 bool world_manager_create_world(WorldInfo info);
 
 bool world_manager_load_world_info(const char* worldDirName);
+// Loads the world without writing anything to it: it isn't upgraded, and the chunks of older versions aren't converted.
+// It has to be closed with world_manager_free, since saving the world info would write it.
+bool world_manager_load_world_info_read_only(const char* worldDirName);
 bool world_manager_save_world_info();
+// Writes a copy of the world info to the given world directory. Safe to call from a worker thread.
+bool world_manager_write_world_info(const char* worldDir, const WorldInfo* info);
 bool world_manager_save_world_info_and_unload();
 void world_manager_free();
 
 WorldInfo* get_world_info();
 bool world_manager_is_world_loaded();
+// Directory of the loaded world, NULL if there is none
+const char* world_manager_get_world_dir();
 
 bool world_manager_save_chunk(Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT]);
+// Safe to call from a worker thread, as long as the world isn't unloaded meanwhile.
 ChunkLoadStatus world_manager_load_chunk(Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT]);
 
+// Saving in two steps, so the writing can happen in another thread:
+// the chunk is serialized into a record (in the main thread, since it reads the block data),
+// and the record is written by any thread, as long as the world isn't unloaded meanwhile.
+bool world_manager_serialize_chunk(ChunkLayer layers[CHUNK_LAYER_COUNT], ByteWriter* writer);
+bool world_manager_write_chunk_record(Vector2i position, const uint8_t* record, size_t size);
+// Saved chunks only replace what was on the disk once they are committed, all at once.
+// Until then, a crash leaves the world as it was at the last commit. Closing the world commits too.
+// Safe to call from any thread. Returns false if some region couldn't be committed.
+bool world_manager_commit_chunks();
+// Tells the OS that the saved chunks in the area (in chunk coordinates, inclusive) are about to be loaded,
+// so it can start reading them from the disk. Does nothing where region files aren't memory mapped.
+// Only regions that are already open are looked at. Safe to call from a worker thread.
+void world_manager_prefetch_chunks(Vector2i start, Vector2i end);
+// Whether the chunk was ever saved in the current world. Answered from an index kept in memory,
+// so chunks that were never saved can be generated right away. Safe to call from a worker thread.
+bool world_manager_has_chunk(Vector2i position);
+// Loads a chunk from a record made by world_manager_serialize_chunk.
+ChunkLoadStatus world_manager_deserialize_chunk(Vector2i position, const uint8_t* record, size_t size, ChunkLayer layers[CHUNK_LAYER_COUNT]);
+
+// Chunks are saved in region files, each with REGION_WIDTH x REGION_WIDTH chunks.
+// Moves the chunks saved by older versions (one file per chunk, in the chunks directory) into region files.
+// Called when the world is loaded. Returns how many chunks were converted.
+int world_manager_convert_legacy_chunks(const char* worldDir);
+// Reads every chunk record of a region file, which doesn't have to belong to the loaded world.
+// Records that point outside of the file are left out, and counted in invalidCount.
+// Returns NULL if the file isn't a region file or can't be read. Safe to call from any thread.
+RegionRecord* world_manager_read_region(const char* path, int* count, int* invalidCount);
+void world_manager_free_region_records(RegionRecord* records, int count);
+// Writes the records to a new region file, packed one after the other, and puts it in place of the old file.
+// Safe to call from any thread, as long as the game doesn't have the region open.
+bool world_manager_write_region(const char* path, const RegionRecord* records, int count);
+// Times saving and loading the given chunks with one file per chunk and with region files,
+// inside a temporary directory of the current world.
+void world_manager_benchmark_storage(ChunkLayer (*layers)[CHUNK_LAYER_COUNT], int count);
+
 bool world_manager_load_world_list();
 WorldListReturnType world_manager_draw_list(mu_Context* ctx);
 
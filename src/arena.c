@@ -0,0 +1,78 @@
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <raylib.h>
+
+struct ArenaBlock {
+    ArenaBlock* next;
+    size_t used;
+    size_t capacity;
+};
+
+static size_t align_size(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1);
+}
+
+// The memory of a block starts right after its header
+static uint8_t* block_data(ArenaBlock* block) {
+    return (uint8_t*)block + align_size(sizeof(ArenaBlock));
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    if (!arena) return NULL;
+    size = align_size(size > 0 ? size : 1);
+
+    ArenaBlock* block = arena->blocks;
+    if (!block || block->capacity - block->used < size) {
+        // Most arenas only get a couple of small pieces, so they start small and grow as needed
+        size_t capacity = block ? block->capacity * 2 : ARENA_INITIAL_BLOCK_SIZE;
+        if (capacity > ARENA_MAX_BLOCK_SIZE) capacity = ARENA_MAX_BLOCK_SIZE;
+        if (capacity < size) capacity = size;
+
+        ArenaBlock* newBlock = malloc(align_size(sizeof(ArenaBlock)) + capacity);
+        if (!newBlock) {
+            TraceLog(LOG_ERROR, "Could not allocate memory for an arena.");
+            return NULL;
+        }
+
+        newBlock->used = 0;
+        newBlock->capacity = capacity;
+        newBlock->next = block;
+        arena->blocks = newBlock;
+        block = newBlock;
+    }
+
+    void* memory = block_data(block) + block->used;
+    block->used += size;
+    memset(memory, 0, size);
+    return memory;
+}
+
+char* arena_strdup(Arena* arena, const char* string) {
+    if (!string) return NULL;
+    size_t length = strlen(string) + 1;
+    char* copy = arena_alloc(arena, length);
+    if (copy) memcpy(copy, string, length);
+    return copy;
+}
+
+size_t arena_get_size(const Arena* arena) {
+    if (!arena) return 0;
+    size_t size = 0;
+    for (ArenaBlock* block = arena->blocks; block; block = block->next) size += align_size(sizeof(ArenaBlock)) + block->capacity;
+    return size;
+}
+
+void arena_free(Arena* arena) {
+    if (!arena) return;
+    ArenaBlock* block = arena->blocks;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+}
@@ -39,19 +39,19 @@ bool plant_block_resolver(BlockExtraResult result, BlockExtraResult other, Block
 bool torch_state_resolver(BlockExtraResult result, BlockExtraResult other, BlockExtraResult neighbors[4], ChunkLayerEnum layer) {
     BlockRegistry* bottom_brg = neighbors[NEIGHBOR_BOTTOM].reg;
     if (bottom_brg->flags & BLOCK_FLAG_SOLID && bottom_brg->flags & BLOCK_FLAG_FULL_BLOCK) {
-        result.block->state = 0;
+        *result.block.state = 0;
         return true;
     }
     
     BlockRegistry* right_brg = neighbors[NEIGHBOR_RIGHT].reg;
     if (right_brg->flags & BLOCK_FLAG_SOLID && right_brg->flags & BLOCK_FLAG_FULL_BLOCK) {
-        result.block->state = 1;
+        *result.block.state = 1;
         return true;
     }
 
     BlockRegistry* left_brg = neighbors[NEIGHBOR_LEFT].reg;
     if (left_brg->flags & BLOCK_FLAG_SOLID && left_brg->flags & BLOCK_FLAG_FULL_BLOCK) {
-        result.block->state = 2;
+        *result.block.state = 2;
         return true;
     }
 
@@ -59,7 +59,7 @@ bool torch_state_resolver(BlockExtraResult result, BlockExtraResult other, Block
         BlockRegistry* wall_rg = other.reg;
         if (wall_rg) {
             if (wall_rg->flags & BLOCK_FLAG_SOLID && wall_rg->flags & BLOCK_FLAG_FULL_BLOCK) {
-                result.block->state = 0;
+                *result.block.state = 0;
                 return true;
             }
         }
@@ -69,29 +69,30 @@ bool torch_state_resolver(BlockExtraResult result, BlockExtraResult other, Block
 }
 
 bool fence_resolver(BlockExtraResult result, BlockExtraResult other, BlockExtraResult neighbors[4], ChunkLayerEnum layer) {
-    bool right = neighbors[NEIGHBOR_RIGHT].block->id == result.block->id;
-	bool left = neighbors[NEIGHBOR_LEFT].block->id == result.block->id;
-    bool up = neighbors[NEIGHBOR_TOP].block->id == result.block->id;
+    bool right = *neighbors[NEIGHBOR_RIGHT].block.id == *result.block.id;
+	bool left = *neighbors[NEIGHBOR_LEFT].block.id == *result.block.id;
+    bool up = *neighbors[NEIGHBOR_TOP].block.id == *result.block.id;
 
-    result.block->state = (uint8_t)((up << 2) | (left << 1) | right);
+    *result.block.state = (uint8_t)((up << 2) | (left << 1) | right);
 
     return true;
 }
 
 bool chest_solver(BlockExtraResult result, BlockExtraResult other, BlockExtraResult neighbors[4], ChunkLayerEnum layer) {
-    if (result.block->data == NULL) {
-        result.block->data = malloc(sizeof(ItemContainer));
-        if (!result.block->data) return false;
-		char* str = calloc(6, sizeof(char));
-		strcpy(str, "Chest");
-        item_container_create(result.block->data, str, 3, 10, false);
+    if (block_ref_get_data(result.block) == NULL) {
+        // The container lives in the arena of the layer, so it goes away with the chunk
+        ItemContainer* container = block_ref_alloc_data(result.block, sizeof(ItemContainer));
+        if (!container) return false;
+        if (!item_container_create_in_arena(container, &result.block.layer->arena, "Chest", 3, 10, false)) return false;
+        if (!block_ref_set_data(result.block, container)) return false;
     }
     return true;
 }
 
 bool on_chest_interact(BlockExtraResult result, ItemSlot holdingItem) {
-    if (result.block->data != NULL) {
-        item_container_open(result.block->data);
+    void* data = block_ref_get_data(result.block);
+    if (data != NULL) {
+        item_container_open(data);
         return true;
     }
     return false;
@@ -102,27 +103,22 @@ bool sign_solver(BlockExtraResult result, BlockExtraResult other, BlockExtraResu
 
     BlockRegistry* bottom_brg = neighbors[NEIGHBOR_BOTTOM].reg;
     if (bottom_brg->flags & BLOCK_FLAG_SOLID && bottom_brg->flags & BLOCK_FLAG_FULL_BLOCK) {
-        result.block->state = 0;
+        *result.block.state = 0;
         valid = true;
     } else if (layer == CHUNK_LAYER_FOREGROUND) {
         BlockRegistry* wall_rg = other.reg;
         if (wall_rg) {
             if (wall_rg->flags & BLOCK_FLAG_SOLID && wall_rg->flags & BLOCK_FLAG_FULL_BLOCK) {
-                result.block->state = 1;
+                *result.block.state = 1;
                 valid = true;
             }
         }
     }
 
-    if (valid && result.block->data == NULL) {
-        result.block->data = malloc(sizeof(SignLines));
-        if (result.block->data) {
-            SignLines* lines = result.block->data;
-            for (int i = 0; i < SIGN_LINE_COUNT; i++) {
-                for (int j = 0; j < SIGN_LINE_LENGTH; j++) {
-                    lines->lines[i][j] = '\0';
-                }
-            }
+    if (valid && block_ref_get_data(result.block) == NULL) {
+        // The arena gives back zeroed memory, so the lines start empty
+        SignLines* lines = block_ref_alloc_data(result.block, sizeof(SignLines));
+        if (lines && block_ref_set_data(result.block, lines)) {
             sign_editor_open(lines);
         }
         else {
@@ -134,7 +130,7 @@ bool sign_solver(BlockExtraResult result, BlockExtraResult other, BlockExtraResu
 }
 
 bool trapdoor_interact(BlockExtraResult result, ItemSlot holdingItem) {
-    TrapdoorState* state = (TrapdoorState*) & result.block->state;
+    TrapdoorState* state = (TrapdoorState*)result.block.state;
     state->open = !state->open;
     return true;
 }
@@ -150,19 +146,19 @@ void set_power_wire_dir(NeighborDirection dir, PowerWireState* state, bool value
 }
 
 bool power_wire_solver(BlockExtraResult result, BlockExtraResult other, BlockExtraResult neighbors[4], ChunkLayerEnum layer) {
-    PowerWireState* s = (PowerWireState*)&result.block->state;
+    PowerWireState* s = (PowerWireState*)result.block.state;
 
     int old_power = (int)s->power;
     int new_power = 0;
 
     // First calculate the directions the wire should be connected
     for (int i = 0; i < 4; i++) {
-        uint8_t blockId = neighbors[i].block->id;
+        uint8_t blockId = *neighbors[i].block.id;
 
         if (blockId == BLOCK_POWER_WIRE || blockId == BLOCK_POWERED_LAMP) {
             set_power_wire_dir(i, s, true);
         } else if (blockId == BLOCK_BATTERY) {
-            LogLikeBlockState batState = (LogLikeBlockState)neighbors[i].block->state;
+            LogLikeBlockState batState = (LogLikeBlockState)*neighbors[i].block.state;
             if (batState == LOGLIKE_BLOCK_STATE_VERTICAL) {
                 if (i == NEIGHBOR_BOTTOM) set_power_wire_dir(i, s, true);
                 if (i == NEIGHBOR_TOP) set_power_wire_dir(i, s, true);
@@ -171,7 +167,7 @@ bool power_wire_solver(BlockExtraResult result, BlockExtraResult other, BlockExt
                 if (i == NEIGHBOR_RIGHT) set_power_wire_dir(i, s, true);
             }
         } else if (blockId == BLOCK_POWER_REPEATER) {
-            PowerRepeaterState* repState = (PowerRepeaterState*)&neighbors[i].block->state;
+            PowerRepeaterState* repState = (PowerRepeaterState*)neighbors[i].block.state;
             if (repState->rotation % 2 == 0) {
                 if (i == NEIGHBOR_LEFT) set_power_wire_dir(i, s, true);
                 if (i == NEIGHBOR_RIGHT) set_power_wire_dir(i, s, true);
@@ -216,10 +212,10 @@ bool power_wire_solver(BlockExtraResult result, BlockExtraResult other, BlockExt
         BlockRegistry* nrg = (BlockRegistry*)nb->reg;
         if (!nrg) continue;
 
-        if (nb->block->id == BLOCK_BATTERY) {
+        if (*nb->block.id == BLOCK_BATTERY) {
             // Check if the battery is from the other layer
-            if (nb->block == other.block) {
-                LogLikeBlockState batState = (LogLikeBlockState)nb->block->state;
+            if (nb->block.id == other.block.id) {
+                LogLikeBlockState batState = (LogLikeBlockState)*nb->block.state;
                 if (batState == LOGLIKE_BLOCK_STATE_FORWARD) {
                     new_power = 15;
                     break;
@@ -228,8 +224,8 @@ bool power_wire_solver(BlockExtraResult result, BlockExtraResult other, BlockExt
                 new_power = 15;
                 break;
             }
-        } else if (nb->block->id == BLOCK_POWER_REPEATER && i < 4) {
-            PowerRepeaterState* repState = (PowerRepeaterState*)&nb->block->state;
+        } else if (*nb->block.id == BLOCK_POWER_REPEATER && i < 4) {
+            PowerRepeaterState* repState = (PowerRepeaterState*)nb->block.state;
             if (repState->powered && 
                 (
                     (repState->rotation == 0 && i == NEIGHBOR_LEFT) ||
@@ -243,8 +239,8 @@ bool power_wire_solver(BlockExtraResult result, BlockExtraResult other, BlockExt
             }
         }
        
-        if (nb->block->id == BLOCK_POWER_WIRE) {
-            PowerWireState* ns = (PowerWireState*)&nb->block->state;
+        if (*nb->block.id == BLOCK_POWER_WIRE) {
+            PowerWireState* ns = (PowerWireState*)nb->block.state;
 
             int neighbor_power = (int)ns->power;
             if (neighbor_power > 0) {
@@ -288,15 +284,15 @@ bool power_wire_solver(BlockExtraResult result, BlockExtraResult other, BlockExt
 }
 
 bool power_repeater_solver(BlockExtraResult result, BlockExtraResult other, BlockExtraResult neighbors[4], ChunkLayerEnum layer) {
-    PowerRepeaterState* s = (PowerRepeaterState*)&result.block->state;
+    PowerRepeaterState* s = (PowerRepeaterState*)result.block.state;
     s->powered = false;
 
     PowerWireState* input = NULL;
     PowerWireState* output = NULL;
 
     for (int i = 0; i < 4; i++) {
-        if (neighbors[i].block->id != BLOCK_POWER_WIRE) continue;
-        PowerWireState* wireState = (PowerWireState*)&neighbors[i].block->state;
+        if (*neighbors[i].block.id != BLOCK_POWER_WIRE) continue;
+        PowerWireState* wireState = (PowerWireState*)neighbors[i].block.state;
 
         if (s->rotation == 0) {
             if (i == NEIGHBOR_LEFT) {
@@ -335,22 +331,22 @@ bool power_repeater_solver(BlockExtraResult result, BlockExtraResult other, Bloc
 }
 
 bool powered_lamp_solver(BlockExtraResult result, BlockExtraResult other, BlockExtraResult neighbors[4], ChunkLayerEnum layer) {
-    result.block->state = 0;
+    *result.block.state = 0;
     
     for (int i = 0; i < 4; i++) {
-        if (neighbors[i].block->id == BLOCK_POWER_WIRE) {
-            PowerWireState* s = (PowerWireState*)&neighbors[i].block->state;
+        if (*neighbors[i].block.id == BLOCK_POWER_WIRE) {
+            PowerWireState* s = (PowerWireState*)neighbors[i].block.state;
             if (s->power > 0) {
-                result.block->state = 1;
+                *result.block.state = 1;
                 break;
             }
         }
     }
 
-    if (other.block->id == BLOCK_POWER_WIRE) {
-        PowerWireState* s = (PowerWireState*)&other.block->state;
+    if (*other.block.id == BLOCK_POWER_WIRE) {
+        PowerWireState* s = (PowerWireState*)other.block.state;
         if (s->power > 0) {
-            result.block->state = 1;
+            *result.block.state = 1;
         }
     }
     
@@ -358,8 +354,8 @@ bool powered_lamp_solver(BlockExtraResult result, BlockExtraResult other, BlockE
 }
 
 bool sign_interact(BlockExtraResult result, ItemSlot holdingItem) {
-    if (result.block->data != NULL) {
-        SignLines* lines = result.block->data;
+    if (block_ref_get_data(result.block) != NULL) {
+        SignLines* lines = block_ref_get_data(result.block);
         sign_editor_open(lines);
         return true;
     }
@@ -367,7 +363,7 @@ bool sign_interact(BlockExtraResult result, ItemSlot holdingItem) {
 }
 
 bool frame_block_interact(BlockExtraResult result, ItemSlot holdingItem) {
-    FrameBlockState* s = (FrameBlockState*)&result.block->state;
+    FrameBlockState* s = (FrameBlockState*)result.block.state;
     if (s->blockIdx <= 0) {
         ItemRegistry* irg = ir_get_item_registry(holdingItem.item_id);
         BlockRegistry* brg = br_get_block_registry(irg->blockId);
@@ -385,7 +381,7 @@ bool falling_block_tick(BlockExtraResult result, BlockExtraResult other, BlockEx
     BlockRegistry* brg = neighbors[NEIGHBOR_BOTTOM].reg;
     if (!brg) return false;
     if (brg->flags & BLOCK_FLAG_REPLACEABLE) {
-        BlockInstance temp = *result.block;
+        BlockInstance temp = block_ref_get(result.block);
         chunk_set_block(neighbors[NEIGHBOR_BOTTOM].chunk, neighbors[NEIGHBOR_BOTTOM].position, temp, layer, false);
         chunk_set_block(result.chunk, result.position, (BlockInstance) { 0, 0, NULL }, layer, false);
         return true;
@@ -400,8 +396,8 @@ bool flow_to_bottom(BlockExtraResult bottom) {
         chunk_set_block(bottom.chunk, bottom.position, (BlockInstance) { BLOCK_WATER_FLOWING, get_flowing_liquid_state(7, true), NULL }, CHUNK_LAYER_FOREGROUND, false);
         return true;
     }
-    else if (brg->flags & BLOCK_FLAG_LIQUID && bottom.block->id == BLOCK_WATER_FLOWING) {
-        FlowingLiquidState* bottomState = (FlowingLiquidState*)&bottom.block->state;
+    else if (brg->flags & BLOCK_FLAG_LIQUID && *bottom.block.id == BLOCK_WATER_FLOWING) {
+        FlowingLiquidState* bottomState = (FlowingLiquidState*)bottom.block.state;
         if (bottomState->level < 7) {
             chunk_set_block(bottom.chunk, bottom.position, (BlockInstance) { BLOCK_WATER_FLOWING, get_flowing_liquid_state(7, true), NULL }, CHUNK_LAYER_FOREGROUND, false);
             return true;
@@ -427,8 +423,8 @@ bool flow_to_sides(BlockExtraResult neighbors[4], int startLevel) {
             chunk_set_block(neighbor.chunk, neighbor.position, (BlockInstance) { BLOCK_WATER_FLOWING, get_flowing_liquid_state(startLevel - 1, false), NULL }, CHUNK_LAYER_FOREGROUND, false);
             placed = true;
         }
-        else if (neighrg->flags & BLOCK_FLAG_LIQUID && neighbor.block->id == BLOCK_WATER_FLOWING) {
-            FlowingLiquidState* neighState = (FlowingLiquidState*)&neighbor.block->state;
+        else if (neighrg->flags & BLOCK_FLAG_LIQUID && *neighbor.block.id == BLOCK_WATER_FLOWING) {
+            FlowingLiquidState* neighState = (FlowingLiquidState*)neighbor.block.state;
             if (!neighState->falling && neighState->level < (startLevel - 1)) {
                 chunk_set_block(neighbor.chunk, neighbor.position, (BlockInstance) { BLOCK_WATER_FLOWING, get_flowing_liquid_state(startLevel - 1, false), NULL }, CHUNK_LAYER_FOREGROUND, false);
                 placed = true;
@@ -455,7 +451,7 @@ bool water_source_tick(BlockExtraResult result, BlockExtraResult other, BlockExt
 bool water_flowing_tick(BlockExtraResult result, BlockExtraResult other, BlockExtraResult neighbors[4], ChunkLayerEnum layer) {
     if (layer != CHUNK_LAYER_FOREGROUND) return false;
 
-    FlowingLiquidState* curState = (FlowingLiquidState*)&result.block->state;
+    FlowingLiquidState* curState = (FlowingLiquidState*)result.block.state;
     if (curState->falling == true) {
         BlockExtraResult top = neighbors[NEIGHBOR_TOP];
         BlockRegistry* trg = top.reg;
@@ -474,7 +470,7 @@ bool water_flowing_tick(BlockExtraResult result, BlockExtraResult other, BlockEx
         if (ret) return true;
 
         if (!(brg->flags & BLOCK_FLAG_REPLACEABLE)) {
-            FlowingLiquidState* curState = (FlowingLiquidState*)&result.block->state;
+            FlowingLiquidState* curState = (FlowingLiquidState*)result.block.state;
             return flow_to_sides(neighbors, curState->level);
         }
         else {
@@ -482,8 +478,8 @@ bool water_flowing_tick(BlockExtraResult result, BlockExtraResult other, BlockEx
         }
     }
     else {
-        if (neighbors[NEIGHBOR_LEFT].block && neighbors[NEIGHBOR_RIGHT].block) {
-            if (neighbors[NEIGHBOR_LEFT].block->id == BLOCK_WATER_SOURCE && neighbors[NEIGHBOR_RIGHT].block->id == BLOCK_WATER_SOURCE) {
+        if (neighbors[NEIGHBOR_LEFT].block.id && neighbors[NEIGHBOR_RIGHT].block.id) {
+            if (*neighbors[NEIGHBOR_LEFT].block.id == BLOCK_WATER_SOURCE && *neighbors[NEIGHBOR_RIGHT].block.id == BLOCK_WATER_SOURCE) {
                 chunk_set_block(result.chunk, result.position, (BlockInstance) { BLOCK_WATER_SOURCE, 0, NULL }, CHUNK_LAYER_FOREGROUND, false);
                 return true;
             }
@@ -496,8 +492,8 @@ bool water_flowing_tick(BlockExtraResult result, BlockExtraResult other, BlockEx
         if (flow_to_bottom(bottom)) return true;
 
         // Flowing to the sides
-        if (neighbors[NEIGHBOR_LEFT].block && neighbors[NEIGHBOR_RIGHT].block) {
-            if (neighbors[NEIGHBOR_LEFT].block->id == BLOCK_WATER_SOURCE && neighbors[NEIGHBOR_RIGHT].block->id == BLOCK_WATER_SOURCE) {
+        if (neighbors[NEIGHBOR_LEFT].block.id && neighbors[NEIGHBOR_RIGHT].block.id) {
+            if (*neighbors[NEIGHBOR_LEFT].block.id == BLOCK_WATER_SOURCE && *neighbors[NEIGHBOR_RIGHT].block.id == BLOCK_WATER_SOURCE) {
                 chunk_set_block(result.chunk, result.position, (BlockInstance) { BLOCK_WATER_SOURCE, 0, NULL }, CHUNK_LAYER_FOREGROUND, false);
                 return true;
             }
@@ -507,13 +503,13 @@ bool water_flowing_tick(BlockExtraResult result, BlockExtraResult other, BlockEx
         int max_neighbor_level = 0;
         for (int i = 0; i < 2; i++) {
             BlockExtraResult neighbor = neighbors[dirs[i]];
-            if (neighbor.block) {
-                if (neighbor.block->id == BLOCK_WATER_SOURCE) {
+            if (neighbor.block.id) {
+                if (*neighbor.block.id == BLOCK_WATER_SOURCE) {
                     max_neighbor_level = 7;
                     break;
                 }
-                else if (neighbor.block->id == BLOCK_WATER_FLOWING) {
-                    FlowingLiquidState* neighState = (FlowingLiquidState*)&neighbor.block->state;
+                else if (*neighbor.block.id == BLOCK_WATER_FLOWING) {
+                    FlowingLiquidState* neighState = (FlowingLiquidState*)neighbor.block.state;
                     if (neighState->level > max_neighbor_level) {
                         max_neighbor_level = neighState->level;
                     }
@@ -549,8 +545,8 @@ bool water_flowing_tick(BlockExtraResult result, BlockExtraResult other, BlockEx
                     chunk_set_block(neighbor.chunk, neighbor.position, (BlockInstance) { BLOCK_WATER_FLOWING, get_flowing_liquid_state(flow_level, false), NULL }, CHUNK_LAYER_FOREGROUND, false);
                     changed = true;
                 }
-                else if (neighrg->flags & BLOCK_FLAG_LIQUID && neighbor.block->id == BLOCK_WATER_FLOWING) {
-                    FlowingLiquidState* neighState = (FlowingLiquidState*)&neighbor.block->state;
+                else if (neighrg->flags & BLOCK_FLAG_LIQUID && *neighbor.block.id == BLOCK_WATER_FLOWING) {
+                    FlowingLiquidState* neighState = (FlowingLiquidState*)neighbor.block.state;
                     if (neighState->level < flow_level) {
                         chunk_set_block(neighbor.chunk, neighbor.position, (BlockInstance) { BLOCK_WATER_FLOWING, get_flowing_liquid_state(flow_level, false), NULL }, CHUNK_LAYER_FOREGROUND, false);
                         changed = true;
@@ -592,21 +588,6 @@ void sign_text_draw(void* data, Vector2 position, uint8_t state) {
     }
 }
 
-void chest_free_data(void* data) {
-    if (data != NULL) {
-        item_container_free(data);
-        free(data);
-        data = NULL;
-    }
-}
-
-void sign_free_data(void* data) {
-    if (data != NULL) {
-        free(data);
-        data = NULL;
-    }
-}
-
 uint32_t chest_data_size(void* data) {
     return item_container_serialized_size(data);
 }
@@ -615,18 +596,22 @@ uint32_t sign_data_size(void* data) {
     return sizeof(SignLines);
 }
 
-void chest_serialize_data(void* data, FILE* fptr) {
-    item_container_serialize(data, fptr);
+void chest_serialize_data(void* data, ByteWriter* writer) {
+    item_container_serialize(data, writer);
 }
 
-void sign_serialize_data(void* data, FILE* fptr) {
-    fwrite(data, sizeof(SignLines), 1, fptr);
+void sign_serialize_data(void* data, ByteWriter* writer) {
+    byte_writer_write(writer, data, sizeof(SignLines));
 }
 
-void* chest_deserialize_data(FILE* fptr) {
-    ItemContainer* data = malloc(sizeof(ItemContainer));
+void* chest_deserialize_data(ByteReader* reader, Arena* arena) {
+    ItemContainer* data = arena_alloc(arena, sizeof(ItemContainer));
     if (data) {
-        item_container_deserialize(data, fptr);
+        // Whatever was allocated stays in the arena until the chunk is freed
+        if (!item_container_deserialize(data, reader, arena)) {
+            TraceLog(LOG_ERROR, "Could not read chest data.");
+            data = NULL;
+        }
     }
     else {
         TraceLog(LOG_ERROR, "Could not allocate memory for chest data.");
@@ -635,10 +620,12 @@ void* chest_deserialize_data(FILE* fptr) {
     return data;
 }
 
-void* sign_deserialize_data(FILE* fptr) {
-    SignLines* data = malloc(sizeof(SignLines));
+void* sign_deserialize_data(ByteReader* reader, Arena* arena) {
+    SignLines* data = arena_alloc(arena, sizeof(SignLines));
     if (data) {
-        fread(data, sizeof(SignLines), 1, fptr);
+        byte_reader_read(reader, data, sizeof(SignLines));
+        // The lines are drawn as strings, so they have to end somewhere
+        for (int i = 0; i < SIGN_LINE_COUNT; i++) data->lines[i][SIGN_LINE_LENGTH - 1] = '\0';
     } else {
         TraceLog(LOG_ERROR, "Could not allocate memory for sign data.");
     }
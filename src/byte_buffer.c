@@ -0,0 +1,101 @@
+#include "byte_buffer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <raylib.h>
+
+static bool reserve(ByteWriter* writer, size_t size) {
+    if (writer->failed) return false;
+    if (writer->size + size <= writer->capacity) return true;
+
+    size_t new_capacity = writer->capacity > 0 ? writer->capacity : BYTE_WRITER_INITIAL_CAPACITY;
+    while (new_capacity < writer->size + size) new_capacity *= 2;
+
+    uint8_t* new_data = realloc(writer->data, new_capacity);
+    if (!new_data) {
+        TraceLog(LOG_ERROR, "Could not allocate memory for the byte writer.");
+        writer->failed = true;
+        return false;
+    }
+
+    writer->data = new_data;
+    writer->capacity = new_capacity;
+    return true;
+}
+
+void byte_writer_clear(ByteWriter* writer) {
+    if (!writer) return;
+    writer->size = 0;
+    writer->failed = false;
+}
+
+void byte_writer_write(ByteWriter* writer, const void* data, size_t size) {
+    if (!writer || size == 0 || !reserve(writer, size)) return;
+    memcpy(writer->data + writer->size, data, size);
+    writer->size += size;
+}
+
+void byte_writer_write_u8(ByteWriter* writer, uint8_t value) {
+    byte_writer_write(writer, &value, sizeof(uint8_t));
+}
+
+void byte_writer_write_u16(ByteWriter* writer, uint16_t value) {
+    byte_writer_write(writer, &value, sizeof(uint16_t));
+}
+
+void byte_writer_write_u32(ByteWriter* writer, uint32_t value) {
+    byte_writer_write(writer, &value, sizeof(uint32_t));
+}
+
+void byte_writer_free(ByteWriter* writer) {
+    if (!writer) return;
+    if (writer->data) free(writer->data);
+    memset(writer, 0, sizeof(ByteWriter));
+}
+
+ByteReader byte_reader_create(const uint8_t* data, size_t size) {
+    return (ByteReader) { data, data ? size : 0, 0, false };
+}
+
+bool byte_reader_read(ByteReader* reader, void* out, size_t size) {
+    if (!reader) return false;
+    if (reader->failed || size > reader->size - reader->position) {
+        reader->failed = true;
+        memset(out, 0, size);
+        return false;
+    }
+
+    memcpy(out, reader->data + reader->position, size);
+    reader->position += size;
+    return true;
+}
+
+uint8_t byte_reader_read_u8(ByteReader* reader) {
+    uint8_t value;
+    byte_reader_read(reader, &value, sizeof(uint8_t));
+    return value;
+}
+
+uint16_t byte_reader_read_u16(ByteReader* reader) {
+    uint16_t value;
+    byte_reader_read(reader, &value, sizeof(uint16_t));
+    return value;
+}
+
+uint32_t byte_reader_read_u32(ByteReader* reader) {
+    uint32_t value;
+    byte_reader_read(reader, &value, sizeof(uint32_t));
+    return value;
+}
+
+bool byte_reader_seek(ByteReader* reader, size_t position) {
+    if (!reader) return false;
+    if (position > reader->size) {
+        reader->failed = true;
+        return false;
+    }
+
+    reader->position = position;
+    return true;
+}
@@ -5,10 +5,12 @@
 #include "world_manager.h"
 #include "registries/block_registry.h"
 #include "lists/block_tick_list.h"
+#include "lists/light_queue.h"
 #include "block_states.h"
 #include "chunk_manager.h"
 #include "types.h"
 
+#include <limits.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -28,6 +30,9 @@ static unsigned int posmod(int v, int m);
 static Material matDefault;
 static bool loadedMatDefault = false;
 
+static LightQueue lightAddQueue = { 0 };
+static LightQueue lightRemoveQueue = { 0 };
+
 static bool chance_at(fnl_noise_type noiseType, float frequency, int gx, int gy, float threshold, int seed_offset) {
     fnl_state noise = fnlCreateState();
     noise.seed = get_world_info()->seed + seed_offset;
@@ -41,21 +46,23 @@ void chunk_init(Chunk* chunk, Vector2i position)
 {
     if (chunk == NULL) return;
 
+    chunk->initialized = false;
     chunk->position = position;
+    chunk->state = CHUNK_STATE_LOADED;
+    chunk->meshDirty = false;
+    chunk->uniform = false;
+    chunk->modified = false;
 
     block_tick_list_clear(&chunk->blockTickList);
 
     chunk_layer_init(&chunk->layers[CHUNK_LAYER_FOREGROUND]);
     chunk_layer_init(&chunk->layers[CHUNK_LAYER_BACKGROUND]);
 
-    // The liquid mesh won't change the amount of vertices so it doesn't need to allocate again
-    chunk->liquidMesh = (Mesh){ 0 };
-    chunk->liquidMesh.vertexCount = CHUNK_AREA * 6;
-    chunk->liquidMesh.triangleCount = chunk->liquidMesh.vertexCount * 3;
-    chunk->liquidMesh.vertices = (float*)MemAlloc(chunk->liquidMesh.vertexCount * 3 * sizeof(float));
-    chunk->liquidMesh.colors = (unsigned char*)MemAlloc(chunk->liquidMesh.vertexCount * 4 * sizeof(unsigned char));
-
-    UploadMesh(&chunk->liquidMesh, true);
+    chunk->render = calloc(1, sizeof(ChunkRender));
+    if (!chunk->render) {
+        TraceLog(LOG_ERROR, "Could not allocate memory for the meshes of chunk (%d, %d).", position.x, position.y);
+        return;
+    }
 
     if (!loadedMatDefault) {
         matDefault = LoadMaterialDefault();
@@ -68,11 +75,12 @@ void chunk_init(Chunk* chunk, Vector2i position)
 void chunk_regenerate(Chunk* chunk) {
     if (!chunk) return;
 
-    for (int i = 0; i < CHUNK_AREA; i++) {
-        chunk->layers[CHUNK_LAYER_BACKGROUND].blocks[i] = (BlockInstance){ 0, 0, NULL };
-        chunk->layers[CHUNK_LAYER_FOREGROUND].blocks[i] = (BlockInstance){ 0, 0, NULL };
-        chunk->light[i] = 0;
+    // Generated blocks never have data, and the chunks given here don't have any yet
+    for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+        memset(chunk->layers[l].ids, BLOCK_AIR, sizeof(chunk->layers[l].ids));
+        memset(chunk->layers[l].states, 0, sizeof(chunk->layers[l].states));
     }
+    memset(chunk->light, 0, sizeof(chunk->light));
 
     if (get_world_info()->preset == WORLD_GEN_PRESET_DEFAULT) {
         fnl_state terrainNoise = fnlCreateState();
@@ -87,13 +95,34 @@ void chunk_regenerate(Chunk* chunk) {
         detailNoise.noise_type = FNL_NOISE_OPENSIMPLEX2;
         detailNoise.fractal_type = FNL_FRACTAL_FBM;
 
+        int surfaces[CHUNK_WIDTH];
+        int minSurface = INT_MAX;
+        int maxSurface = INT_MIN;
+        for (int x = 0; x < CHUNK_WIDTH; x++) {
+            int gx = chunk->position.x * CHUNK_WIDTH + x;
+
+            float base = fnlGetNoise2D(&terrainNoise, gx * 0.5f, 0.0f);
+            float detail = fnlGetNoise2D(&detailNoise, gx, 0.0f);
+            surfaces[x] = (int)roundf(base * 32.0f + detail * 8.0f);
+
+            if (surfaces[x] < minSurface) minSurface = surfaces[x];
+            if (surfaces[x] > maxSurface) maxSurface = surfaces[x];
+        }
+
+        // Chunks above the terrain are all air and the ones below the dirt are all stone,
+        // so they don't need to go through every block
+        int top = chunk->position.y * CHUNK_WIDTH;
+        int bottom = top + CHUNK_WIDTH - 1;
+        if (bottom < minSurface - 1) return;
+        if (top > maxSurface + 4) {
+            for (int l = 0; l < CHUNK_LAYER_COUNT; l++) memset(chunk->layers[l].ids, BLOCK_STONE, sizeof(chunk->layers[l].ids));
+            return;
+        }
+
         for (int w = 0; w < 2; w++) {
             for (int x = 0; x < CHUNK_WIDTH; x++) {
                 int gx = chunk->position.x * CHUNK_WIDTH + x;
-
-                float base = fnlGetNoise2D(&terrainNoise, gx * 0.5f, 0.0f);
-                float detail = fnlGetNoise2D(&detailNoise, gx, 0.0f);
-                int surfaceY = (int)roundf(base * 32.0f + detail * 8.0f);
+                int surfaceY = surfaces[x];
 
                 for (int y = 0; y < CHUNK_WIDTH; y++) {
                     int i = x + y * CHUNK_WIDTH;
@@ -122,13 +151,18 @@ void chunk_regenerate(Chunk* chunk) {
                         newInst.id = BLOCK_STONE;
                     }
 
-                    if (w == 0) chunk->layers[CHUNK_LAYER_FOREGROUND].blocks[i] = newInst;
-                    else chunk->layers[CHUNK_LAYER_BACKGROUND].blocks[i] = newInst;
+                    ChunkLayer* target = &chunk->layers[w == 0 ? CHUNK_LAYER_FOREGROUND : CHUNK_LAYER_BACKGROUND];
+                    target->ids[i] = newInst.id;
+                    target->states[i] = newInst.state;
                 }
             }
         }
     } else if (get_world_info()->preset == WORLD_GEN_PRESET_FLAT) {
         if (chunk->position.y < 0) return;
+        if (chunk->position.y * CHUNK_WIDTH > (CHUNK_WIDTH / 2) + 10) {
+            for (int l = 0; l < CHUNK_LAYER_COUNT; l++) memset(chunk->layers[l].ids, BLOCK_STONE, sizeof(chunk->layers[l].ids));
+            return;
+        }
 
         for (int w = 0; w < 2; w++) {
             for (int y = 0; y < CHUNK_WIDTH; y++) {
@@ -147,8 +181,9 @@ void chunk_regenerate(Chunk* chunk) {
 
                     int i = x + y * CHUNK_WIDTH;
 
-                    if (w == 0) chunk->layers[CHUNK_LAYER_FOREGROUND].blocks[i] = newInst;
-                    else chunk->layers[CHUNK_LAYER_BACKGROUND].blocks[i] = newInst;
+                    ChunkLayer* target = &chunk->layers[w == 0 ? CHUNK_LAYER_FOREGROUND : CHUNK_LAYER_BACKGROUND];
+                    target->ids[i] = newInst.id;
+                    target->states[i] = newInst.state;
                 }
             }
         }
@@ -156,39 +191,33 @@ void chunk_regenerate(Chunk* chunk) {
         if (chunk->position.x == 0 && chunk->position.y == 0) {
             for (int x = 0; x < CHUNK_WIDTH; x++) {
                 int i = x + 1 * CHUNK_WIDTH;
-                chunk->layers[CHUNK_LAYER_FOREGROUND].blocks[i] = (BlockInstance) { BLOCK_STONE, 0, NULL };
+                chunk->layers[CHUNK_LAYER_FOREGROUND].ids[i] = BLOCK_STONE;
             }
         }
     }
 }
 
-void chunk_gen_liquid_mesh(Chunk* chunk) {
-    if (!chunk) return;
-
-    for (int v = 0; v < chunk->liquidMesh.vertexCount; v++) {
-        int vi = v * 3;
-        chunk->liquidMesh.vertices[vi + 0] = 0.0f;
-        chunk->liquidMesh.vertices[vi + 1] = 0.0f;
-        chunk->liquidMesh.vertices[vi + 2] = 0.0f;
+// Writes the liquid quads into the given buffers, which must have room for CHUNK_VERTEX_COUNT vertices.
+// Returns false if the chunk doesn't have any liquids.
+static bool chunk_build_liquid_mesh(Chunk* chunk, float* vertices, unsigned char* colors) {
+    memset(vertices, 0, CHUNK_VERTEX_COUNT * 3 * sizeof(float));
+    memset(colors, 0, CHUNK_VERTEX_COUNT * 4 * sizeof(unsigned char));
 
-        int ci = v * 4;
-        chunk->liquidMesh.colors[ci + 0] = 0;
-        chunk->liquidMesh.colors[ci + 1] = 0;
-        chunk->liquidMesh.colors[ci + 2] = 0;
-        chunk->liquidMesh.colors[ci + 3] = 0;
-    }
+    ChunkLayer* foreground = &chunk->layers[CHUNK_LAYER_FOREGROUND];
+    bool hasLiquids = false;
 
     for (int i = 0; i < CHUNK_AREA; i++) {
-        BlockRegistry* rg = br_get_block_registry(chunk->layers[CHUNK_LAYER_FOREGROUND].blocks[i].id);
+        BlockRegistry* rg = br_get_block_registry(foreground->ids[i]);
         if (!rg) continue;
         if (!(rg->flags & BLOCK_FLAG_LIQUID)) continue;
+        hasLiquids = true;
 
         int x = i % CHUNK_WIDTH;
         int y = i / CHUNK_WIDTH;
 
-        FlowingLiquidState* state = (FlowingLiquidState*)&chunk->layers[CHUNK_LAYER_FOREGROUND].blocks[i].state;
+        FlowingLiquidState* state = (FlowingLiquidState*)&foreground->states[i];
         float value = 0.125f + (state->level / 7.0f) * (1.0f - 0.125f);
-        if (chunk->layers[CHUNK_LAYER_FOREGROUND].blocks[i].id == BLOCK_WATER_SOURCE) value = 1.0f;
+        if (foreground->ids[i] == BLOCK_WATER_SOURCE) value = 1.0f;
 
         BlockExtraResult neighbors[4];
         chunk_get_block_neighbors_extra(chunk, (Vector2u) { x, y }, CHUNK_LAYER_FOREGROUND, neighbors);
@@ -205,10 +234,10 @@ void chunk_gen_liquid_mesh(Chunk* chunk) {
             if (!nrg) continue;
             if (!(nrg->flags & BLOCK_FLAG_LIQUID)) continue;
 
-            FlowingLiquidState* neighState = (FlowingLiquidState*)&neigh.block->state;
+            FlowingLiquidState* neighState = (FlowingLiquidState*)neigh.block.state;
             float val = 0.125f + (neighState->level / 7.0f) * (1.0f - 0.125f);
 
-            if (neigh.block->id == BLOCK_WATER_SOURCE || (neigh.block->id == BLOCK_WATER_FLOWING && neighState->falling)) {
+            if (*neigh.block.id == BLOCK_WATER_SOURCE || (*neigh.block.id == BLOCK_WATER_FLOWING && neighState->falling)) {
                 *value = 1.0f;
             }
             else {
@@ -227,47 +256,132 @@ void chunk_gen_liquid_mesh(Chunk* chunk) {
         int base = i * 6 * 3;
         int colorBase = i * 6 * 4;
 
-        chunk->liquidMesh.vertices[base + 0] = x0;
-        chunk->liquidMesh.vertices[base + 1] = y_top_left;
-        chunk->liquidMesh.vertices[base + 2] = 0.0f;
+        vertices[base + 0] = x0;
+        vertices[base + 1] = y_top_left;
+        vertices[base + 2] = 0.0f;
 
-        chunk->liquidMesh.vertices[base + 3] = x1;
-        chunk->liquidMesh.vertices[base + 4] = y_top_right;
-        chunk->liquidMesh.vertices[base + 5] = 0.0f;
+        vertices[base + 3] = x1;
+        vertices[base + 4] = y_top_right;
+        vertices[base + 5] = 0.0f;
 
-        chunk->liquidMesh.vertices[base + 6] = x1;
-        chunk->liquidMesh.vertices[base + 7] = y_bottom;
-        chunk->liquidMesh.vertices[base + 8] = 0.0f;
+        vertices[base + 6] = x1;
+        vertices[base + 7] = y_bottom;
+        vertices[base + 8] = 0.0f;
 
-        chunk->liquidMesh.vertices[base + 9] = x0;
-        chunk->liquidMesh.vertices[base + 10] = y_top_left;
-        chunk->liquidMesh.vertices[base + 11] = 0.0f;
+        vertices[base + 9] = x0;
+        vertices[base + 10] = y_top_left;
+        vertices[base + 11] = 0.0f;
 
-        chunk->liquidMesh.vertices[base + 12] = x1;
-        chunk->liquidMesh.vertices[base + 13] = y_bottom;
-        chunk->liquidMesh.vertices[base + 14] = 0.0f;
+        vertices[base + 12] = x1;
+        vertices[base + 13] = y_bottom;
+        vertices[base + 14] = 0.0f;
 
-        chunk->liquidMesh.vertices[base + 15] = x0;
-        chunk->liquidMesh.vertices[base + 16] = y_bottom;
-        chunk->liquidMesh.vertices[base + 17] = 0.0f;
+        vertices[base + 15] = x0;
+        vertices[base + 16] = y_bottom;
+        vertices[base + 17] = 0.0f;
 
         float lightFactor = chunk->light[i] / 15.0f;
 
         for (int v = 0; v < 6; v++) {
             int c = colorBase + v * 4;
-            chunk->liquidMesh.colors[c + 0] = 0;
-            chunk->liquidMesh.colors[c + 1] = 0;
-            chunk->liquidMesh.colors[c + 2] = 255 * lightFactor;
-            chunk->liquidMesh.colors[c + 3] = 100;
+            colors[c + 0] = 0;
+            colors[c + 1] = 0;
+            colors[c + 2] = 255 * lightFactor;
+            colors[c + 3] = 100;
         }
     }
 
-    UpdateMeshBuffer(chunk->liquidMesh, 0, chunk->liquidMesh.vertices, chunk->liquidMesh.vertexCount * 3 * sizeof(float), 0);
-    UpdateMeshBuffer(chunk->liquidMesh, 3, chunk->liquidMesh.colors, chunk->liquidMesh.vertexCount * 4 * sizeof(unsigned char), 0);
+    return hasLiquids;
 }
 
-void chunk_genmesh(Chunk* chunk) {
-    if (chunk == NULL) return;
+static void chunk_get_mesh_inputs(Chunk* chunk, ChunkMeshInputs* out) {
+    memset(out, 0, sizeof(ChunkMeshInputs));
+
+    for (int y = -1; y <= CHUNK_WIDTH; y++) {
+        for (int x = -1; x <= CHUNK_WIDTH; x++) {
+            int j = (x + 1) + (y + 1) * CHUNK_MESH_INPUT_WIDTH;
+            out->light[j] = chunk_get_light_extrapolating(chunk, (Vector2i) { x, y });
+
+            // Cells of missing neighbors are left as dark air, which is meshed the same way
+            for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+                BlockExtraResult block = chunk_get_block_extrapolating_ptr(chunk, (Vector2i) { x, y }, l);
+                if (!block.block.id) continue;
+                out->ids[l][j] = *block.block.id;
+                out->states[l][j] = *block.block.state;
+            }
+        }
+    }
+
+    GameSettings* settings = get_game_settings();
+    out->position = chunk->position;
+    out->wallBrightness = settings->wall_brightness;
+    out->wallAoBrightness = settings->wall_ao_brightness;
+    out->smoothLighting = settings->smooth_lighting;
+    out->wallAo = settings->wall_ao;
+    out->valid = true;
+}
+
+static bool chunk_mesh_settings_equal(const ChunkMeshInputs* a, const ChunkMeshInputs* b) {
+    return a->valid && b->valid &&
+        a->position.x == b->position.x && a->position.y == b->position.y &&
+        a->wallBrightness == b->wallBrightness && a->wallAoBrightness == b->wallAoBrightness &&
+        a->smoothLighting == b->smoothLighting && a->wallAo == b->wallAo;
+}
+
+static bool chunk_mesh_inputs_equal(const ChunkMeshInputs* a, const ChunkMeshInputs* b) {
+    return chunk_mesh_settings_equal(a, b) &&
+        memcmp(a->light, b->light, sizeof(a->light)) == 0 &&
+        memcmp(a->ids, b->ids, sizeof(a->ids)) == 0 &&
+        memcmp(a->states, b->states, sizeof(a->states)) == 0;
+}
+
+// Sets the cells whose block, or any cell around it, changed between the two inputs.
+// Returns false when the whole chunk has to be meshed, like when there is no previous mesh or the settings changed.
+static bool chunk_find_changed_cells(const ChunkMeshInputs* previous, const ChunkMeshInputs* current, uint32_t cells[CHUNK_AREA / 32]) {
+    if (!previous || !chunk_mesh_settings_equal(previous, current)) return false;
+
+    bool changed[CHUNK_MESH_INPUT_WIDTH * CHUNK_MESH_INPUT_WIDTH];
+    for (int j = 0; j < CHUNK_MESH_INPUT_WIDTH * CHUNK_MESH_INPUT_WIDTH; j++) {
+        changed[j] = previous->light[j] != current->light[j];
+        for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+            if (previous->ids[l][j] != current->ids[l][j] || previous->states[l][j] != current->states[l][j]) changed[j] = true;
+        }
+    }
+
+    memset(cells, 0, sizeof(uint32_t) * (CHUNK_AREA / 32));
+    for (int i = 0; i < CHUNK_AREA; i++) {
+        int x = i % CHUNK_WIDTH;
+        int y = i / CHUNK_WIDTH;
+
+        // The cell at (x, y) is at (x + 1, y + 1) in the inputs, so its neighbors start at (x, y)
+        bool dirty = false;
+        for (int dy = 0; dy < 3 && !dirty; dy++) {
+            for (int dx = 0; dx < 3 && !dirty; dx++) {
+                dirty = changed[(x + dx) + (y + dy) * CHUNK_MESH_INPUT_WIDTH];
+            }
+        }
+        if (dirty) cells[i / 32] |= 1u << (i % 32);
+    }
+
+    return true;
+}
+
+bool chunk_build_mesh_data(Chunk* chunk, const ChunkMeshInputs* previous, ChunkMeshData* out) {
+    if (chunk == NULL || out == NULL) return false;
+
+    // A chunk that is all air has nothing to show
+    if (chunk->uniform && chunk->layers[CHUNK_LAYER_FOREGROUND].ids[0] == BLOCK_AIR) {
+        memset(out, 0, sizeof(ChunkMeshData));
+        chunk_get_mesh_inputs(chunk, &out->inputs);
+        return true;
+    }
+
+    chunk_get_mesh_inputs(chunk, &out->inputs);
+
+    // Only the cells that changed since the previous mesh are generated, the rest are copied from it
+    uint32_t cells[CHUNK_AREA / 32];
+    bool partial = chunk_find_changed_cells(previous, &out->inputs, cells);
+    if (partial) out->base = *previous;
     unsigned int seed = (unsigned int)(chunk->position.x * 73856093 ^ chunk->position.y * 19349663);
 
     for (int i = 0; i < CHUNK_LAYER_COUNT; i++) {
@@ -276,27 +390,115 @@ void chunk_genmesh(Chunk* chunk) {
         int front_layer_id = i + 1;
         if (front_layer_id >= CHUNK_LAYER_COUNT) front_layer_id = CHUNK_LAYER_COUNT - 1;
 
-        chunk_layer_genmesh(
+        bool built = chunk_layer_build_mesh_data(
             &chunk->layers[i],
             i,
             front_layer_id,
             chunk,
             seed,
-            i == CHUNK_LAYER_BACKGROUND ? (uint8_t)get_game_settings()->wall_brightness : 255
+            i == CHUNK_LAYER_BACKGROUND ? (uint8_t)get_game_settings()->wall_brightness : 255,
+            partial ? cells : NULL,
+            &out->layers[i]
         );
+
+        if (!built) {
+            for (int j = 0; j < i; j++) chunk_layer_free_mesh_data(&out->layers[j]);
+            return false;
+        }
+    }
+
+    out->hasLiquids = chunk_build_liquid_mesh(chunk, out->liquidVertices, out->liquidColors);
+    return true;
+}
+
+void chunk_apply_mesh_data(Chunk* chunk, ChunkMeshData* data) {
+    if (chunk == NULL || data == NULL || chunk->render == NULL) return;
+
+    // Partial layers only fit the mesh they were built on, which might have been replaced since
+    bool fits = !data->layers[0].partial || chunk_mesh_inputs_equal(&chunk->render->meshInputs, &data->base);
+    bool applied = fits;
+
+    for (int i = 0; i < CHUNK_LAYER_COUNT; i++) {
+        if (!fits) chunk_layer_free_mesh_data(&data->layers[i]);
+        else if (!chunk_layer_apply_mesh_data(&chunk->render->layers[i], &data->layers[i])) applied = false;
+    }
+
+    if (applied) {
+        chunk->render->meshInputs = data->inputs;
+    }
+    else {
+        // The whole chunk is meshed again instead
+        chunk->render->meshInputs.valid = false;
+        chunk->meshDirty = true;
+    }
+
+    if (chunk->state == CHUNK_STATE_LIT) chunk->state = CHUNK_STATE_MESHED;
+
+    // Most chunks don't have any liquids, so the liquid mesh is only made once there are some
+    Mesh* liquidMesh = &chunk->render->liquidMesh;
+    if (!chunk->render->initializedLiquidMesh) {
+        if (!data->hasLiquids) return;
+
+        // The liquid mesh won't change the amount of vertices so it doesn't need to allocate again
+        *liquidMesh = (Mesh){ 0 };
+        liquidMesh->vertexCount = CHUNK_VERTEX_COUNT;
+        liquidMesh->triangleCount = liquidMesh->vertexCount * 3;
+        liquidMesh->vertices = (float*)MemAlloc(sizeof(data->liquidVertices));
+        liquidMesh->colors = (unsigned char*)MemAlloc(sizeof(data->liquidColors));
+        if (!liquidMesh->vertices || !liquidMesh->colors) {
+            TraceLog(LOG_ERROR, "Could not allocate memory for the liquid mesh of chunk (%d, %d).", chunk->position.x, chunk->position.y);
+            MemFree(liquidMesh->vertices);
+            MemFree(liquidMesh->colors);
+            *liquidMesh = (Mesh){ 0 };
+            return;
+        }
+
+        memcpy(liquidMesh->vertices, data->liquidVertices, sizeof(data->liquidVertices));
+        memcpy(liquidMesh->colors, data->liquidColors, sizeof(data->liquidColors));
+        UploadMesh(liquidMesh, true);
+        chunk->render->initializedLiquidMesh = true;
+        return;
     }
 
-    chunk_gen_liquid_mesh(chunk);
+    // Avoid sending the same buffer every time
+    if (memcmp(liquidMesh->vertices, data->liquidVertices, sizeof(data->liquidVertices)) != 0 ||
+        memcmp(liquidMesh->colors, data->liquidColors, sizeof(data->liquidColors)) != 0) {
+        memcpy(liquidMesh->vertices, data->liquidVertices, sizeof(data->liquidVertices));
+        memcpy(liquidMesh->colors, data->liquidColors, sizeof(data->liquidColors));
+
+        UpdateMeshBuffer(*liquidMesh, 0, liquidMesh->vertices, liquidMesh->vertexCount * 3 * sizeof(float), 0);
+        UpdateMeshBuffer(*liquidMesh, 3, liquidMesh->colors, liquidMesh->vertexCount * 4 * sizeof(unsigned char), 0);
+    }
+}
+
+void chunk_genmesh(Chunk* chunk) {
+    if (chunk == NULL) return;
+    chunk->meshDirty = false;
+
+    ChunkMeshData* data = calloc(1, sizeof(ChunkMeshData));
+    if (!data) {
+        TraceLog(LOG_ERROR, "Could not allocate memory for building the chunk mesh.");
+        return;
+    }
+
+    if (chunk_build_mesh_data(chunk, chunk->render ? &chunk->render->meshInputs : NULL, data)) chunk_apply_mesh_data(chunk, data);
+    free(data);
 }
 
 void chunk_update_tick_list(Chunk* chunk) {
     if (!chunk) return;
     block_tick_list_clear(&chunk->blockTickList);
+
+    // Uniform chunks are made of blocks like air and stone, which are never ticked
+    if (chunk->uniform) {
+        BlockRegistry* brg = br_get_block_registry(chunk->layers[CHUNK_LAYER_FOREGROUND].ids[0]);
+        if (!brg || brg->tick_callback == NULL) return;
+    }
     for (int i = 0; i < CHUNK_AREA; i++) {
         for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
-            BlockInstance* binst = &chunk->layers[l].blocks[i];
-            if (binst->id == BLOCK_AIR) continue;
-            BlockRegistry* brg = br_get_block_registry(binst->id);
+            uint8_t id = chunk->layers[l].ids[i];
+            if (id == BLOCK_AIR) continue;
+            BlockRegistry* brg = br_get_block_registry(id);
             if (!brg) continue;
             if (brg->tick_callback == NULL) continue;
             BlockTickListEntry entry = {
@@ -309,7 +511,7 @@ void chunk_update_tick_list(Chunk* chunk) {
 }
 
 void chunk_draw(Chunk* chunk) {
-    if (!chunk) return;
+    if (!chunk || !chunk->render) return;
 
     rlPushMatrix();
 
@@ -319,14 +521,14 @@ void chunk_draw(Chunk* chunk) {
         0.0f
     );
 
-    chunk_layer_draw(&chunk->layers[CHUNK_LAYER_BACKGROUND]);
-    chunk_layer_draw(&chunk->layers[CHUNK_LAYER_FOREGROUND]);
+    chunk_layer_draw(&chunk->layers[CHUNK_LAYER_BACKGROUND], &chunk->render->layers[CHUNK_LAYER_BACKGROUND]);
+    chunk_layer_draw(&chunk->layers[CHUNK_LAYER_FOREGROUND], &chunk->render->layers[CHUNK_LAYER_FOREGROUND]);
 
     rlPopMatrix();
 }
 
 void chunk_draw_liquids(Chunk* chunk) {
-    if (!chunk) return;
+    if (!chunk || !chunk->render || !chunk->render->initializedLiquidMesh) return;
 
     rlPushMatrix();
 
@@ -337,7 +539,7 @@ void chunk_draw_liquids(Chunk* chunk) {
     );
 
     rlDrawRenderBatchActive();
-    DrawMesh(chunk->liquidMesh, matDefault, MatrixIdentity());
+    DrawMesh(chunk->render->liquidMesh, matDefault, MatrixIdentity());
 
     rlPopMatrix();
 }
@@ -345,19 +547,19 @@ void chunk_draw_liquids(Chunk* chunk) {
 void chunk_tick(Chunk* chunk, uint8_t tick_value) {
     if (!chunk) return;
 
-    bool changed = false;
-    size_t count = chunk->blockTickList.count;
+    size_t count = block_tick_list_count(&chunk->blockTickList);
 
     for (size_t i = 0; i < count; i++) {
-        BlockTickListEntry entry = chunk->blockTickList.entries[i];
+        BlockTickListEntry entry;
+        if (!block_tick_list_get(&chunk->blockTickList, i, &entry)) break;
 
-        BlockInstance* ptr = chunk_get_block_ptr(chunk, entry.position, entry.layer);
-        if (!ptr) {
+        BlockRef ptr = chunk_get_block_ptr(chunk, entry.position, entry.layer);
+        if (!ptr.id) {
             block_tick_list_remove_by_index(&chunk->blockTickList, i);
             continue;
         }
 
-        BlockRegistry* brg = br_get_block_registry(ptr->id);
+        BlockRegistry* brg = br_get_block_registry(*ptr.id);
         if (!brg || brg->tick_callback == NULL) {
             block_tick_list_remove_by_index(&chunk->blockTickList, i);
             continue;
@@ -375,8 +577,8 @@ void chunk_tick(Chunk* chunk, uint8_t tick_value) {
         };
 
         ChunkLayerEnum otherLayer = entry.layer == CHUNK_LAYER_BACKGROUND ? CHUNK_LAYER_FOREGROUND : CHUNK_LAYER_BACKGROUND;
-        BlockInstance* other_inst = chunk_get_block_ptr(chunk, entry.position, otherLayer);
-        BlockRegistry* other_br = br_get_block_registry(other_inst->id);
+        BlockRef other_inst = chunk_get_block_ptr(chunk, entry.position, otherLayer);
+        BlockRegistry* other_br = br_get_block_registry(*other_inst.id);
 
         BlockExtraResult other = {
             .block = other_inst,
@@ -389,12 +591,26 @@ void chunk_tick(Chunk* chunk, uint8_t tick_value) {
         uint8_t mod = tick_value % brg->tick_speed;
         if (mod == (brg->tick_speed-1)) {
             bool did_change = brg->tick_callback(result, other, neighbors, entry.layer);
-            if (changed == false) changed = did_change;
-        }
-    }
+            if (did_change) {
+                chunk->uniform = false;
+                chunk->modified = true;
+                for (int n = 0; n < 4; n++) {
+                    if (!neighbors[n].chunk) continue;
+                    neighbors[n].chunk->uniform = false;
+                    neighbors[n].chunk->modified = true;
+                }
 
-    if (changed) {
-        chunk_manager_update_lighting();
+                // Callbacks can also change the blocks right next to them
+                Vector2i globalPos = {
+                    chunk->position.x * CHUNK_WIDTH + (int)entry.position.x,
+                    chunk->position.y * CHUNK_WIDTH + (int)entry.position.y
+                };
+                chunk_manager_update_lighting_area(
+                    (Vector2i) { globalPos.x - 1, globalPos.y - 1 },
+                    (Vector2i) { globalPos.x + 1, globalPos.y + 1 }
+                );
+            }
+        }
     }
 }
 
@@ -402,11 +618,15 @@ void chunk_tick(Chunk* chunk, uint8_t tick_value) {
 void chunk_free_meshes(Chunk* chunk) {
     if (!chunk) return;
 
-    for (int i = 0; i < CHUNK_LAYER_COUNT; i++) {
-        chunk_layer_free_mesh(&chunk->layers[i]);
-    }
+    if (chunk->render) {
+        for (int i = 0; i < CHUNK_LAYER_COUNT; i++) {
+            chunk_layer_free_mesh(&chunk->render->layers[i]);
+        }
 
-    UnloadMesh(chunk->liquidMesh);
+        if (chunk->render->initializedLiquidMesh) UnloadMesh(chunk->render->liquidMesh);
+        free(chunk->render);
+        chunk->render = NULL;
+    }
 
     chunk->initialized = false;
 }
@@ -419,79 +639,205 @@ void chunk_free_block_data(Chunk* chunk) {
     }
 }
 
-void chunk_fill_light(Chunk* chunk, Vector2u startPoint, uint8_t newLightValue) {
-    if (!chunk) return;
-    if (newLightValue < 1 || newLightValue > 15) return;
-    if (startPoint.x >= CHUNK_WIDTH) return;
-    if (startPoint.y >= CHUNK_WIDTH) return;
+// Light passes through a block when it's transparent or when it is not a full block.
+static bool block_lets_light_through(const ChunkLayer* layer, int idx) {
+    return !br_get_block_variant(layer->ids[idx], layer->states[idx])->opaque;
+}
+
+// Gets the neighbor cell in the given direction (0 = left, 1 = right, 2 = down, 3 = up),
+// going to the neighboring chunk when needed. Returns NULL if there is no chunk there,
+// or if that chunk is still being loaded.
+static Chunk* light_neighbor(Chunk* chunk, uint8_t idx, int dir, uint8_t* out_idx) {
+    int x = idx % CHUNK_WIDTH;
+    int y = idx / CHUNK_WIDTH;
+    Chunk* next = chunk;
+
+    switch (dir) {
+        case 0:
+            if (x == 0) { next = chunk->neighbors.left; x = CHUNK_WIDTH - 1; }
+            else x--;
+            break;
+        case 1:
+            if (x == CHUNK_WIDTH - 1) { next = chunk->neighbors.right; x = 0; }
+            else x++;
+            break;
+        case 2:
+            if (y == CHUNK_WIDTH - 1) { next = chunk->neighbors.down; y = 0; }
+            else y++;
+            break;
+        case 3:
+            if (y == 0) { next = chunk->neighbors.up; y = CHUNK_WIDTH - 1; }
+            else y--;
+            break;
+    }
 
-    uint8_t current = chunk_get_light(chunk, startPoint);
-    if (current >= newLightValue) return;
+    if (next && next->state == CHUNK_STATE_REQUESTED) return NULL;
 
-    chunk_set_light(chunk, startPoint, newLightValue);
+    *out_idx = (uint8_t)(x + y * CHUNK_WIDTH);
+    return next;
+}
 
-    uint8_t decayAmount = 4;
+uint8_t chunk_get_light_source(Chunk* chunk, Vector2u position) {
+    if (!chunk) return 0;
+    if (position.x >= CHUNK_WIDTH || position.y >= CHUNK_WIDTH) return 0;
 
-    BlockInstance binst = chunk_get_block(chunk, startPoint, CHUNK_LAYER_FOREGROUND);
-    BlockRegistry* br = br_get_block_registry(binst.id);
+    int i = position.x + position.y * CHUNK_WIDTH;
+    ChunkLayer* foreground = &chunk->layers[CHUNK_LAYER_FOREGROUND];
+    ChunkLayer* background = &chunk->layers[CHUNK_LAYER_BACKGROUND];
 
-    if (br->lightLevel == BLOCK_LIGHT_TRANSPARENT || !(br->flags & BLOCK_FLAG_FULL_BLOCK)) {
-        decayAmount = 1;
-    }
+    if (block_lets_light_through(foreground, i) && block_lets_light_through(background, i)) return 15;
 
-    Vector2i neighbors[] = {
-        { -1, 0 }, { 1, 0 }, { 0, 1 }, { 0, -1 }
-    };
+    BlockRegistry* bbr = br_get_block_registry(foreground->ids[i]);
+    BlockRegistry* wbr = br_get_block_registry(background->ids[i]);
 
-    for (int i = 0; i < 4; i++) {
-        Chunk* nextChunk = chunk;
+    int maxLight = bbr->lightLevel > wbr->lightLevel ? bbr->lightLevel : wbr->lightLevel;
+    return maxLight > 0 ? (uint8_t)maxLight : 0;
+}
 
-        Vector2i neighPos = {
-            .x = startPoint.x + neighbors[i].x,
-            .y = startPoint.y + neighbors[i].y
-        };
+void chunk_queue_light(Chunk* chunk, Vector2u position, uint8_t value) {
+    if (!chunk || chunk->state == CHUNK_STATE_REQUESTED) return;
+    if (value < 1 || value > 15) return;
+    if (position.x >= CHUNK_WIDTH || position.y >= CHUNK_WIDTH) return;
 
-        if (neighPos.x < 0) {
-            nextChunk = chunk->neighbors.left;
-            neighPos.x = posmod(neighPos.x, CHUNK_WIDTH);
-        }
-        else if (neighPos.x >= CHUNK_WIDTH) {
-            nextChunk = chunk->neighbors.right;
-            neighPos.x = posmod(neighPos.x, CHUNK_WIDTH);
+    uint8_t idx = position.x + position.y * CHUNK_WIDTH;
+    if (chunk->light[idx] >= value) return;
+
+    chunk->light[idx] = value;
+    light_queue_push(&lightAddQueue, (LightQueueEntry) { chunk, idx, value });
+}
+
+void chunk_queue_light_removal(Chunk* chunk, Vector2u position) {
+    if (!chunk || chunk->state == CHUNK_STATE_REQUESTED) return;
+    if (position.x >= CHUNK_WIDTH || position.y >= CHUNK_WIDTH) return;
+
+    uint8_t idx = position.x + position.y * CHUNK_WIDTH;
+    light_queue_push(&lightRemoveQueue, (LightQueueEntry) { chunk, idx, chunk->light[idx] });
+    chunk->light[idx] = 0;
+
+    // The block on this cell may be a light source by itself
+    chunk_queue_light(chunk, position, chunk_get_light_source(chunk, position));
+}
+
+void chunk_propagate_light() {
+    LightQueueEntry entry;
+
+    // First pass: darken every cell that got its light from the removed cells.
+    // Cells that are brighter (or equally bright) than the removed light are lit by something
+    // else, so they are queued to spread their light back into the darkened area.
+    while (light_queue_pop(&lightRemoveQueue, &entry)) {
+        for (int dir = 0; dir < 4; dir++) {
+            uint8_t nidx;
+            Chunk* next = light_neighbor(entry.chunk, entry.idx, dir, &nidx);
+            if (!next) continue;
+
+            uint8_t neighborLight = next->light[nidx];
+            if (neighborLight == 0) continue;
+
+            if (neighborLight < entry.value) {
+                Vector2u npos = { nidx % CHUNK_WIDTH, nidx / CHUNK_WIDTH };
+                uint8_t source = chunk_get_light_source(next, npos);
+
+                if (source >= neighborLight) {
+                    light_queue_push(&lightAddQueue, (LightQueueEntry) { next, nidx, neighborLight });
+                    continue;
+                }
+
+                next->light[nidx] = 0;
+                light_queue_push(&lightRemoveQueue, (LightQueueEntry) { next, nidx, neighborLight });
+                chunk_queue_light(next, npos, source);
+            }
+            else {
+                light_queue_push(&lightAddQueue, (LightQueueEntry) { next, nidx, neighborLight });
+            }
         }
-        if (neighPos.y < 0) {
-            nextChunk = chunk->neighbors.up;
-            neighPos.y = posmod(neighPos.y, CHUNK_WIDTH);
+    }
+
+    // Second pass: spread the light from the queued cells.
+    while (light_queue_pop(&lightAddQueue, &entry)) {
+        Chunk* chunk = entry.chunk;
+        uint8_t current = chunk->light[entry.idx];
+
+        uint8_t decayAmount = 4;
+        if (block_lets_light_through(&chunk->layers[CHUNK_LAYER_FOREGROUND], entry.idx)) decayAmount = 1;
+
+        if (current <= decayAmount) continue;
+
+        for (int dir = 0; dir < 4; dir++) {
+            uint8_t nidx;
+            Chunk* next = light_neighbor(chunk, entry.idx, dir, &nidx);
+            if (!next) continue;
+
+            chunk_queue_light(next, (Vector2u) { nidx % CHUNK_WIDTH, nidx / CHUNK_WIDTH }, current - decayAmount);
         }
-        else if (neighPos.y >= CHUNK_WIDTH) {
-            nextChunk = chunk->neighbors.down;
-            neighPos.y = posmod(neighPos.y, CHUNK_WIDTH);
+    }
+}
+
+void chunk_fill_light(Chunk* chunk, Vector2u startPoint, uint8_t newLightValue) {
+    chunk_queue_light(chunk, startPoint, newLightValue);
+    chunk_propagate_light();
+}
+
+void chunk_queue_uniform_light(Chunk* chunk) {
+    if (!chunk || !chunk->uniform || chunk->state == CHUNK_STATE_REQUESTED) return;
+
+    uint8_t source = chunk_get_light_source(chunk, (Vector2u) { 0, 0 });
+    memset(chunk->light, source, sizeof(chunk->light));
+
+    // Light spread from the inside would only reach cells that already have it
+    for (int b = 0; b < CHUNK_WIDTH * 4; b++) {
+        int k = b % CHUNK_WIDTH;
+        uint8_t idx;
+        switch (b / CHUNK_WIDTH) {
+            case 0: idx = k; break;
+            case 1: idx = k + (CHUNK_WIDTH - 1) * CHUNK_WIDTH; break;
+            case 2: idx = k * CHUNK_WIDTH; break;
+            default: idx = k * CHUNK_WIDTH + CHUNK_WIDTH - 1; break;
         }
 
-        if (nextChunk) chunk_fill_light(nextChunk, (Vector2u) { neighPos.x, neighPos.y }, newLightValue - decayAmount);
+        if (source > 0) light_queue_push(&lightAddQueue, (LightQueueEntry) { chunk, idx, source });
+
+        for (int dir = 0; dir < 4; dir++) {
+            uint8_t nidx;
+            Chunk* next = light_neighbor(chunk, idx, dir, &nidx);
+            if (!next || next == chunk || next->light[nidx] == 0) continue;
+            light_queue_push(&lightAddQueue, (LightQueueEntry) { next, nidx, next->light[nidx] });
+        }
     }
 }
 
+void chunk_update_light(Chunk* chunk, Vector2u position) {
+    chunk_queue_light_removal(chunk, position);
+    chunk_propagate_light();
+}
+
+void chunk_free_light_queues() {
+    light_queue_free(&lightAddQueue);
+    light_queue_free(&lightRemoveQueue);
+}
+
 void chunk_propagate_power_wire(Chunk* chunk, Vector2u startPoint, ChunkLayerEnum layer, uint8_t newPowerValue) {
     if (!chunk) return;
     if (startPoint.x >= CHUNK_WIDTH || startPoint.y >= CHUNK_WIDTH) return;
 
     if (newPowerValue > 15) return;
     if (newPowerValue < 1) {
-        chunk_genmesh(chunk);
+        // The mesh is regenerated with the rest of the changes, not on every step
+        chunk->meshDirty = true;
         return;
     }
 
     int i = startPoint.x + startPoint.y * CHUNK_WIDTH;
 
-    BlockInstance* bptr = &chunk->layers[layer].blocks[i];
-    if (bptr->id != BLOCK_POWER_WIRE) return;
+    if (chunk->layers[layer].ids[i] != BLOCK_POWER_WIRE) return;
 
-    PowerWireState* s = (PowerWireState*)&bptr->state;
+    PowerWireState* s = (PowerWireState*)&chunk->layers[layer].states[i];
     uint8_t current = s->power;
     if (current >= newPowerValue) return;
 
     s->power = newPowerValue;
+    chunk->meshDirty = true;
+    chunk->uniform = false;
+    chunk->modified = true;
 
     BlockExtraResult neighbors[4];
     chunk_get_block_neighbors_extra(chunk, startPoint, layer, neighbors);
@@ -511,11 +857,9 @@ void chunk_propagate_remove_power_wire(Chunk* chunk, Vector2u point, ChunkLayerE
     if (point.x >= CHUNK_WIDTH || point.y >= CHUNK_WIDTH) return;
 
     int idx = (int)point.x + (int)point.y * CHUNK_WIDTH;
-    BlockInstance* bptr = &chunk->layers[layer].blocks[idx];
-
-    if (bptr->id != BLOCK_POWER_WIRE) return;
+    if (chunk->layers[layer].ids[idx] != BLOCK_POWER_WIRE) return;
 
-    PowerWireState* s = (PowerWireState*)&bptr->state;
+    PowerWireState* s = (PowerWireState*)&chunk->layers[layer].states[idx];
     uint8_t old_power = s->power;
     if (old_power == 0) return;
 
@@ -525,10 +869,10 @@ void chunk_propagate_remove_power_wire(Chunk* chunk, Vector2u point, ChunkLayerE
     uint8_t maxp = 0;
     for (int i = 0; i < 4; ++i) {
         BlockExtraResult n = neighbors[i];
-        if (!n.block || !n.reg) continue;
+        if (!n.block.id || !n.reg) continue;
 
-        if (n.block->id == BLOCK_POWER_WIRE) {
-            PowerWireState* ns = (PowerWireState*)&n.block->state;
+        if (*n.block.id == BLOCK_POWER_WIRE) {
+            PowerWireState* ns = (PowerWireState*)n.block.state;
             if (ns->power > 0) {
                 uint8_t cand = ns->power - 1;
                 if (cand > maxp) maxp = cand;
@@ -539,12 +883,14 @@ void chunk_propagate_remove_power_wire(Chunk* chunk, Vector2u point, ChunkLayerE
     if (maxp < old_power) {
         s->power = maxp;
 
-        chunk_genmesh(chunk);
+        chunk->meshDirty = true;
+        chunk->uniform = false;
+        chunk->modified = true;
 
         for (int i = 0; i < 4; ++i) {
             BlockExtraResult n = neighbors[i];
-            if (!n.block || !n.reg) continue;
-            if (n.block->id != BLOCK_POWER_WIRE) continue;
+            if (!n.block.id || !n.reg) continue;
+            if (*n.block.id != BLOCK_POWER_WIRE) continue;
             if (!n.chunk) continue;
 
             chunk_propagate_remove_power_wire(n.chunk, n.position, layer);
@@ -553,7 +899,10 @@ void chunk_propagate_remove_power_wire(Chunk* chunk, Vector2u point, ChunkLayerE
 }
 
 DownProjectionResult chunk_get_block_projected_downwards(Chunk* chunk, Vector2u startPoint, ChunkLayerEnum layer, bool goToNeighbor) {
-    DownProjectionResult empty = { { NULL, NULL, NULL, { UINT8_MAX, UINT8_MAX }, UINT8_MAX }, { NULL, NULL, NULL, { UINT8_MAX, UINT8_MAX }, UINT8_MAX } };
+    DownProjectionResult empty = {
+        .replaced = { .position = { UINT8_MAX, UINT8_MAX }, .idx = UINT8_MAX },
+        .down = { .position = { UINT8_MAX, UINT8_MAX }, .idx = UINT8_MAX }
+    };
     if (!chunk) return empty;
 
     for (unsigned int y = startPoint.y; y < CHUNK_WIDTH; y++) {
@@ -563,16 +912,16 @@ DownProjectionResult chunk_get_block_projected_downwards(Chunk* chunk, Vector2u
         }
 
         BlockExtraResult down = chunk_get_block_extrapolating_ptr(chunk, (Vector2i) { startPoint.x, y + 1 }, layer);
-        if (down.block == NULL) return empty;
+        if (down.block.id == NULL) return empty;
 
-        BlockRegistry* br = br_get_block_registry(down.block->id);
+        BlockRegistry* br = br_get_block_registry(*down.block.id);
         if (br == NULL) return empty;
 
         if (!(br->flags & BLOCK_FLAG_REPLACEABLE)) {
             uint8_t idx = startPoint.x + (y * CHUNK_WIDTH);
             return (DownProjectionResult) {
                 .replaced = (BlockExtraResult){
-                    .block = &chunk->layers[layer].blocks[idx],
+                    .block = chunk_layer_get_ref(&chunk->layers[layer], idx),
                     .chunk = chunk,
                     .position = (Vector2u){ startPoint.x, y },
                     .idx = idx
@@ -589,20 +938,20 @@ DownProjectionResult chunk_get_block_projected_downwards(Chunk* chunk, Vector2u
     else { return empty; }
 }
 
-BlockInstance* chunk_get_block_ptr(Chunk* chunk, Vector2u position, ChunkLayerEnum layer) {
-    if (!chunk) return NULL;
-    if (position.x >= CHUNK_WIDTH ||position.y >= CHUNK_WIDTH) return NULL;
-    return &chunk->layers[layer].blocks[position.x + (position.y * CHUNK_WIDTH)];
+BlockRef chunk_get_block_ptr(Chunk* chunk, Vector2u position, ChunkLayerEnum layer) {
+    if (!chunk) return (BlockRef) { 0 };
+    if (position.x >= CHUNK_WIDTH ||position.y >= CHUNK_WIDTH) return (BlockRef) { 0 };
+    return chunk_layer_get_ref(&chunk->layers[layer], position.x + (position.y * CHUNK_WIDTH));
 }
 
 BlockExtraResult chunk_get_block_extrapolating_ptr(Chunk* chunk, Vector2i position, ChunkLayerEnum layer) {
-    if (!chunk) return (BlockExtraResult){ NULL, NULL, NULL, { UINT8_MAX, UINT8_MAX }, UINT8_MAX };
+    if (!chunk) return (BlockExtraResult){ .position = { UINT8_MAX, UINT8_MAX }, .idx = UINT8_MAX };
 
     if (position.x >= 0 && position.y >= 0 && position.x < CHUNK_WIDTH && position.y < CHUNK_WIDTH) {
-        BlockInstance* inst = chunk_get_block_ptr(chunk, (Vector2u) { position.x, position.y }, layer);
+        BlockRef inst = chunk_get_block_ptr(chunk, (Vector2u) { position.x, position.y }, layer);
 		return (BlockExtraResult) {
             .block = inst,
-            .reg = br_get_block_registry(inst->id),
+            .reg = br_get_block_registry(*inst.id),
             .chunk = chunk,
             .position = (Vector2u) { (unsigned int)position.x, (unsigned int)position.y },
 			.idx = (uint8_t)(position.x + (position.y * CHUNK_WIDTH))
@@ -620,17 +969,17 @@ BlockExtraResult chunk_get_block_extrapolating_ptr(Chunk* chunk, Vector2i positi
         else if (position.y < 0) neighbor = (Chunk*)chunk->neighbors.up;
         else if (position.y >= CHUNK_WIDTH) neighbor = (Chunk*)chunk->neighbors.down;
 
-        if (neighbor == NULL) return (BlockExtraResult) { NULL, NULL, NULL, { UINT8_MAX, UINT8_MAX }, UINT8_MAX };
+        if (neighbor == NULL) return (BlockExtraResult) { .position = { UINT8_MAX, UINT8_MAX }, .idx = UINT8_MAX };
 
         Vector2u relPos = {
             .x = posmod(position.x, CHUNK_WIDTH),
             .y = posmod(position.y, CHUNK_WIDTH)
         };
 
-        BlockInstance* inst = chunk_get_block_ptr(neighbor, relPos, layer);
+        BlockRef inst = chunk_get_block_ptr(neighbor, relPos, layer);
 		return (BlockExtraResult) {
             .block = inst,
-            .reg = br_get_block_registry(inst->id),
+            .reg = br_get_block_registry(*inst.id),
             .chunk = neighbor,
             .position = relPos,
 			.idx = (uint8_t)(relPos.x + (relPos.y * CHUNK_WIDTH))
@@ -682,12 +1031,14 @@ LightExtraResult chunk_get_light_extrapolating_ptr(Chunk* chunk, Vector2i positi
 }
 
 bool chunk_solve_block(Chunk* chunk, Vector2u position, ChunkLayerEnum layer) {
-    BlockInstance* inst = chunk_get_block_ptr(chunk, position, layer);
-    if (!inst) return false;
-    BlockRegistry* br = br_get_block_registry(inst->id);
+    BlockRef inst = chunk_get_block_ptr(chunk, position, layer);
+    if (!inst.id) return false;
+    BlockRegistry* br = br_get_block_registry(*inst.id);
     if (!br) return false;
 
     bool can_place = true;
+    uint8_t beforeId = *inst.id;
+    uint8_t beforeState = *inst.state;
 
     if (br->state_resolver != NULL) {
         BlockExtraResult neighbors[4];
@@ -703,9 +1054,9 @@ bool chunk_solve_block(Chunk* chunk, Vector2u position, ChunkLayerEnum layer) {
 
         ChunkLayerEnum otherLayer = layer == CHUNK_LAYER_FOREGROUND ? CHUNK_LAYER_BACKGROUND : CHUNK_LAYER_FOREGROUND;
 
-        BlockInstance* other_inst = chunk_get_block_ptr(chunk, position, otherLayer);
-        if (!other_inst) return false;
-        BlockRegistry* other_br = br_get_block_registry(other_inst->id);
+        BlockRef other_inst = chunk_get_block_ptr(chunk, position, otherLayer);
+        if (!other_inst.id) return false;
+        BlockRegistry* other_br = br_get_block_registry(*other_inst.id);
         if (!other_br) return false;
 
         BlockExtraResult other = {
@@ -720,20 +1071,28 @@ bool chunk_solve_block(Chunk* chunk, Vector2u position, ChunkLayerEnum layer) {
     }
 
     if (!can_place) {
-        *inst = (BlockInstance) { 0, 0, NULL };
+        chunk_layer_set_block(inst.layer, inst.idx, (BlockInstance) { 0, 0, NULL });
+    }
+
+    // Solving also changes the blocks next to the one that was placed, which can be on other chunks
+    if (*inst.id != beforeId || *inst.state != beforeState) {
+        chunk->uniform = false;
+        chunk->modified = true;
     }
 
     return can_place;
 }
 
 void chunk_set_block(Chunk* chunk, Vector2u position, BlockInstance blockValue, ChunkLayerEnum layer, bool update_lighting) {
-    BlockInstance* ptr = chunk_get_block_ptr(chunk, position, layer);
-    if (!ptr) return;
-    if (ptr->id == blockValue.id && ptr->state == blockValue.state) return;
+    BlockRef ptr = chunk_get_block_ptr(chunk, position, layer);
+    if (!ptr.id) return;
+    // Whatever is placed here would be overwritten when the chunk finishes loading
+    if (chunk->state == CHUNK_STATE_REQUESTED) return;
+    if (*ptr.id == blockValue.id && *ptr.state == blockValue.state) return;
 
     // Handle destruction of the previous block
-    if (ptr->id > 0) {
-        BlockRegistry* old_br = br_get_block_registry(ptr->id);
+    if (*ptr.id > 0) {
+        BlockRegistry* old_br = br_get_block_registry(*ptr.id);
         if (old_br) {
             if (old_br->tick_callback != NULL) {
                 block_tick_list_remove(&chunk->blockTickList, (BlockTickListEntry) { position, layer });
@@ -750,23 +1109,36 @@ void chunk_set_block(Chunk* chunk, Vector2u position, BlockInstance blockValue,
                 old_br->destroy_callback(res, layer);
             }
             if (old_br->free_data) {
-                old_br->free_data(ptr->data);
+                old_br->free_data(block_ref_get_data(ptr));
             }
         }
     }
 
     // Set the block
-    *ptr = blockValue;
+    chunk_layer_set_block(ptr.layer, ptr.idx, blockValue);
+    chunk->uniform = false;
+    chunk->modified = true;
+
+    Vector2i globalPos = {
+        chunk->position.x * CHUNK_WIDTH + (int)position.x,
+        chunk->position.y * CHUNK_WIDTH + (int)position.y
+    };
 
     // Resolve the state of the new placed block
     bool ret = chunk_solve_block(chunk, position, layer);
-    if (!ret) return;
+    if (!ret) {
+        // The block couldn't stay, but the previous one is gone anyways
+        if (update_lighting) chunk_manager_update_lighting_area(globalPos, globalPos);
+        return;
+    }
 
     // Resolve state for neighboring blocks
     BlockExtraResult neighbors[4];
+    uint8_t neighborIds[4];
     chunk_get_block_neighbors_extra(chunk, position, layer, neighbors);
     for (int i = 0; i < 4; i++) {
         BlockExtraResult neighbor = neighbors[i];
+        neighborIds[i] = neighbor.block.id ? *neighbor.block.id : 0;
         chunk_solve_block(neighbor.chunk, neighbor.position, layer);
     }
 
@@ -774,7 +1146,23 @@ void chunk_set_block(Chunk* chunk, Vector2u position, BlockInstance blockValue,
     ChunkLayerEnum otherLayer = layer == CHUNK_LAYER_FOREGROUND ? CHUNK_LAYER_BACKGROUND : CHUNK_LAYER_FOREGROUND;
     chunk_solve_block(chunk, position, otherLayer);
 
-    if (update_lighting) chunk_manager_update_lighting();
+    if (update_lighting) {
+        Vector2i start = globalPos;
+        Vector2i end = globalPos;
+
+        // Solving may have broken neighboring blocks, so their light has to be updated too
+        for (int i = 0; i < 4; i++) {
+            BlockExtraResult neighbor = neighbors[i];
+            if (!neighbor.block.id || !neighbor.chunk) continue;
+            if (*neighbor.block.id != neighborIds[i]) {
+                start = (Vector2i) { globalPos.x - 1, globalPos.y - 1 };
+                end = (Vector2i) { globalPos.x + 1, globalPos.y + 1 };
+                break;
+            }
+        }
+
+        chunk_manager_update_lighting_area(start, end);
+    }
 
     // Add tick for new block if applicable
     BlockRegistry* br = br_get_block_registry(blockValue.id);
@@ -789,20 +1177,20 @@ void chunk_set_block(Chunk* chunk, Vector2u position, BlockInstance blockValue,
 
 BlockExtraResult chunk_set_block_extrapolating(Chunk* chunk, Vector2i position, BlockInstance blockValue, ChunkLayerEnum layer, bool update_lighting) {
     BlockExtraResult result = chunk_get_block_extrapolating_ptr(chunk, position, layer);
-    if (!result.block || !result.chunk) return result;
+    if (!result.block.id || !result.chunk) return result;
     chunk_set_block(result.chunk, result.position, blockValue, layer, update_lighting);
     return result;
 }
 
 BlockInstance chunk_get_block(Chunk* chunk, Vector2u position, ChunkLayerEnum layer) {
-    BlockInstance* ptr = chunk_get_block_ptr(chunk, position, layer);
-    if (!ptr) return (BlockInstance){ 0, 0, NULL };
-    return *ptr;
+    BlockRef ptr = chunk_get_block_ptr(chunk, position, layer);
+    if (!ptr.id) return (BlockInstance){ 0, 0, NULL };
+    return block_ref_get(ptr);
 }
 
 BlockInstance chunk_get_block_extrapolating(Chunk* chunk, Vector2i position, ChunkLayerEnum layer) {
     BlockExtraResult result = chunk_get_block_extrapolating_ptr(chunk, (Vector2i) { position.x, position.y }, layer);
-    if (!result.block || !result.chunk) return (BlockInstance){ 0, 0, NULL };
+    if (!result.block.id || !result.chunk) return (BlockInstance){ 0, 0, NULL };
     return chunk_get_block(result.chunk, result.position, layer);
 }
 
@@ -0,0 +1,150 @@
+#include "chunk_codec.h"
+
+#include <string.h>
+
+
+// Smallest amount of bits that fits every palette index
+static int index_bits(int paletteCount) {
+    int bits = 0;
+    while ((1 << bits) < paletteCount) bits++;
+    return bits;
+}
+
+size_t chunk_codec_encode(const ChunkLayer layers[CHUNK_LAYER_COUNT], uint8_t* out) {
+    uint16_t palette[CHUNK_CODEC_BLOCK_COUNT];
+    uint16_t indices[CHUNK_CODEC_BLOCK_COUNT];
+    int paletteCount = 0;
+    int last = 0;
+
+    // Palettes are tiny, so a linear search (starting from the last match) is enough
+    for (int i = 0; i < CHUNK_CODEC_BLOCK_COUNT; i++) {
+        const ChunkLayer* layer = &layers[i / CHUNK_AREA];
+        uint16_t key = (uint16_t)((layer->ids[i % CHUNK_AREA] << 8) | layer->states[i % CHUNK_AREA]);
+
+        if (paletteCount == 0 || palette[last] != key) {
+            int p = 0;
+            while (p < paletteCount && palette[p] != key) p++;
+            if (p == paletteCount) palette[paletteCount++] = key;
+            last = p;
+        }
+        indices[i] = (uint16_t)last;
+    }
+
+    bool wideIndices = paletteCount > 256;
+
+    // Noisy chunks take less space with the indices packed, and everything else with the runs
+    size_t runsSize = 0;
+    for (int i = 0; i < CHUNK_CODEC_BLOCK_COUNT;) {
+        int run = 1;
+        while (i + run < CHUNK_CODEC_BLOCK_COUNT && run < 256 && indices[i + run] == indices[i]) run++;
+        runsSize += wideIndices ? 3 : 2;
+        i += run;
+    }
+
+    int bits = index_bits(paletteCount);
+    size_t packedSize = ((size_t)CHUNK_CODEC_BLOCK_COUNT * bits + 7) / 8;
+    bool packed = packedSize < runsSize;
+
+    size_t size = 0;
+    out[size++] = packed ? CHUNK_CODEC_PACKED : CHUNK_CODEC_RUNS;
+    out[size++] = (uint8_t)(paletteCount & 0xFF);
+    out[size++] = (uint8_t)(paletteCount >> 8);
+    for (int p = 0; p < paletteCount; p++) {
+        out[size++] = (uint8_t)(palette[p] >> 8);
+        out[size++] = (uint8_t)(palette[p] & 0xFF);
+    }
+
+    if (packed) {
+        memset(&out[size], 0, packedSize);
+        size_t bit = 0;
+        for (int i = 0; i < CHUNK_CODEC_BLOCK_COUNT; i++) {
+            for (int b = 0; b < bits; b++, bit++) {
+                if (indices[i] & (1 << b)) out[size + bit / 8] |= (uint8_t)(1 << (bit % 8));
+            }
+        }
+        return size + packedSize;
+    }
+
+    int i = 0;
+    while (i < CHUNK_CODEC_BLOCK_COUNT) {
+        int run = 1;
+        while (i + run < CHUNK_CODEC_BLOCK_COUNT && run < 256 && indices[i + run] == indices[i]) run++;
+
+        out[size++] = (uint8_t)(run - 1);
+        out[size++] = (uint8_t)(indices[i] & 0xFF);
+        if (wideIndices) out[size++] = (uint8_t)(indices[i] >> 8);
+
+        i += run;
+    }
+
+    return size;
+}
+
+bool chunk_codec_decode(const uint8_t* in, size_t size, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    if (!in || size < 3) return false;
+
+    size_t pos = 0;
+    uint8_t mode = in[pos++];
+    int paletteCount = in[pos] | (in[pos + 1] << 8);
+    pos += 2;
+
+    if (paletteCount < 1 || paletteCount > CHUNK_CODEC_BLOCK_COUNT) return false;
+    if (pos + (size_t)paletteCount * 2 > size) return false;
+
+    const uint8_t* palette = &in[pos];
+    pos += (size_t)paletteCount * 2;
+
+    if (mode == CHUNK_CODEC_PACKED) {
+        int bits = index_bits(paletteCount);
+        if (pos + ((size_t)CHUNK_CODEC_BLOCK_COUNT * bits + 7) / 8 > size) return false;
+
+        size_t bit = pos * 8;
+        for (int i = 0; i < CHUNK_CODEC_BLOCK_COUNT; i++) {
+            int index = 0;
+            for (int b = 0; b < bits; b++, bit++) {
+                if (in[bit / 8] & (1 << (bit % 8))) index |= 1 << b;
+            }
+            if (index >= paletteCount) return false;
+
+            layers[i / CHUNK_AREA].ids[i % CHUNK_AREA] = palette[index * 2];
+            layers[i / CHUNK_AREA].states[i % CHUNK_AREA] = palette[index * 2 + 1];
+        }
+        return true;
+    }
+    if (mode != CHUNK_CODEC_RUNS) return false;
+
+    bool wideIndices = paletteCount > 256;
+
+    int i = 0;
+    while (i < CHUNK_CODEC_BLOCK_COUNT) {
+        if (pos + (wideIndices ? 3 : 2) > size) return false;
+
+        int run = in[pos++] + 1;
+        int index = in[pos++];
+        if (wideIndices) index |= in[pos++] << 8;
+
+        if (index >= paletteCount || i + run > CHUNK_CODEC_BLOCK_COUNT) return false;
+
+        for (int r = 0; r < run; r++, i++) {
+            layers[i / CHUNK_AREA].ids[i % CHUNK_AREA] = palette[index * 2];
+            layers[i / CHUNK_AREA].states[i % CHUNK_AREA] = palette[index * 2 + 1];
+        }
+    }
+
+    return true;
+}
+
+bool chunk_codec_is_uniform(const ChunkLayer layers[CHUNK_LAYER_COUNT], BlockInstance* out) {
+    uint8_t id = layers[0].ids[0];
+    uint8_t state = layers[0].states[0];
+
+    for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+        if (layers[l].dataCount > 0) return false;
+        for (int i = 0; i < CHUNK_AREA; i++) {
+            if (layers[l].ids[i] != id || layers[l].states[i] != state) return false;
+        }
+    }
+
+    if (out) *out = (BlockInstance) { id, state, NULL };
+    return true;
+}
@@ -1,5 +1,8 @@
 #include "chunk_layer.h"
+#include "byte_buffer.h"
 #include "game_settings.h"
+#include "item_container.h"
+#include "sign_editor.h"
 #include "registries/block_models.h"
 #include "registries/block_registry.h"
 #include "registries/texture_atlas.h"
@@ -10,53 +13,165 @@
 #include <rlgl.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 void chunk_layer_init(ChunkLayer* layer) {
     if (!layer) return;
 
-    for (int i = 0; i < CHUNK_AREA; i++) {
-        layer->blocks[i].data = NULL;
-        layer->blocks[i].id = BLOCK_AIR;
-        layer->blocks[i].state = 0;
+    memset(layer->ids, BLOCK_AIR, sizeof(layer->ids));
+    memset(layer->states, 0, sizeof(layer->states));
+    layer->data = NULL;
+    layer->dataCount = 0;
+    layer->dataCapacity = 0;
+    layer->arena = (Arena) { 0 };
+    layer->deadData = 0;
+}
+
+static int find_data_entry(const ChunkLayer* layer, int idx) {
+    for (int d = 0; d < layer->dataCount; d++) {
+        if (layer->data[d].idx == idx) return d;
     }
+    return -1;
+}
 
-    layer->initializedMesh = false;
+BlockInstance chunk_layer_get_block(const ChunkLayer* layer, int idx) {
+    return (BlockInstance) { layer->ids[idx], layer->states[idx], chunk_layer_get_data(layer, idx) };
 }
 
-void chunk_layer_genmesh(ChunkLayer* layer, ChunkLayerEnum layer_id, ChunkLayerEnum front_layer_id, void* c, unsigned int chunk_pos_seed, uint8_t brightness) {
-    if (!layer || !c) return;
-    Chunk* chunk = (Chunk*)c;
+void chunk_layer_set_block(ChunkLayer* layer, int idx, BlockInstance block) {
+    layer->ids[idx] = block.id;
+    layer->states[idx] = block.state;
+    chunk_layer_set_data(layer, idx, block.data);
+}
 
-    // Get total amount of vertices needed
-    int vertexCount = 0;
-    for (int i = 0; i < CHUNK_AREA; i++) {
-        BlockInstance block = layer->blocks[i];
-        BlockRegistry* brg = br_get_block_registry(block.id);
-        BlockVariant bvar = brg->variant_generator(block.state);
-        layer->vertexOffsets[i] = vertexCount;
-        vertexCount += block_models_get_vertex_count(bvar.model_idx);
+void* chunk_layer_get_data(const ChunkLayer* layer, int idx) {
+    if (layer->dataCount == 0) return NULL;
+    int d = find_data_entry(layer, idx);
+    return d >= 0 ? layer->data[d].data : NULL;
+}
+
+// Copies the data in use to a new arena through the serializers of the blocks, and frees the old arena with
+// the removed data in it. If any of the data can't be copied, everything stays where it was.
+static void chunk_layer_compact_data(ChunkLayer* layer) {
+    // The open windows point straight into the arena, so it has to wait until they are closed
+    if (item_container_is_open() || sign_editor_is_open()) return;
+
+    void** copies = malloc(sizeof(void*) * layer->dataCount);
+    if (!copies) return;
+
+    Arena arena = { 0 };
+    ByteWriter writer = { 0 };
+    bool copied = true;
+
+    for (int d = 0; d < layer->dataCount && copied; d++) {
+        BlockRegistry* rg = br_get_block_registry(layer->ids[layer->data[d].idx]);
+        if (!rg || !rg->data_serializer || !rg->data_deserializer) {
+            copied = false;
+            break;
+        }
+
+        byte_writer_clear(&writer);
+        rg->data_serializer(layer->data[d].data, &writer);
+        ByteReader reader = byte_reader_create(writer.data, writer.size);
+        copies[d] = writer.failed ? NULL : rg->data_deserializer(&reader, &arena);
+        if (!copies[d]) copied = false;
+    }
+    byte_writer_free(&writer);
+
+    if (copied) {
+        for (int d = 0; d < layer->dataCount; d++) layer->data[d].data = copies[d];
+        arena_free(&layer->arena);
+        layer->arena = arena;
+        layer->deadData = 0;
+    }
+    else {
+        arena_free(&arena);
+    }
+    free(copies);
+}
+
+bool chunk_layer_set_data(ChunkLayer* layer, int idx, void* data) {
+    int d = find_data_entry(layer, idx);
+
+    if (!data) {
+        // The order doesn't matter, so the last entry takes its place
+        if (d >= 0) {
+            layer->data[d] = layer->data[--layer->dataCount];
+            layer->deadData++;
+        }
+
+        // Nothing points into the arena anymore, so the memory of the removed data can be given back
+        if (layer->dataCount == 0) {
+            arena_free(&layer->arena);
+            layer->deadData = 0;
+        }
+        // Copying is only worth it once there is more removed data than data in use
+        else if (layer->deadData > layer->dataCount) {
+            chunk_layer_compact_data(layer);
+        }
+        return true;
+    }
+
+    if (d >= 0) {
+        if (layer->data[d].data != data) layer->deadData++;
+        layer->data[d].data = data;
+        return true;
     }
 
-    if (layer->initializedMesh == true) {
-        UnloadMesh(layer->mesh);
-        layer->initializedMesh = false;
+    if (layer->dataCount == layer->dataCapacity) {
+        int newCapacity = layer->dataCapacity > 0 ? layer->dataCapacity * 2 : 4;
+        BlockDataEntry* newData = realloc(layer->data, sizeof(BlockDataEntry) * newCapacity);
+        if (!newData) {
+            TraceLog(LOG_ERROR, "Could not allocate memory for the block data list.");
+            return false;
+        }
+        layer->data = newData;
+        layer->dataCapacity = newCapacity;
     }
 
-    // Reset mesh
-    layer->mesh = (Mesh){0};
-    layer->mesh.vertexCount = vertexCount;
-    layer->mesh.triangleCount = vertexCount * 3;
-    layer->mesh.vertices = (float*)MemAlloc(vertexCount * 3 * sizeof(float));
-    layer->mesh.texcoords = (float*)MemAlloc(vertexCount * 2 * sizeof(float));
-    layer->mesh.colors = (unsigned char*)MemAlloc(vertexCount * 4 * sizeof(unsigned char));
-    layer->initializedMesh = true;
+    layer->data[layer->dataCount++] = (BlockDataEntry) { (uint8_t)idx, data };
+    return true;
+}
+
+void* chunk_layer_alloc_data(ChunkLayer* layer, size_t size) {
+    return arena_alloc(&layer->arena, size);
+}
+
+BlockRef chunk_layer_get_ref(ChunkLayer* layer, int idx) {
+    return (BlockRef) { &layer->ids[idx], &layer->states[idx], layer, (uint8_t)idx };
+}
+
+BlockInstance block_ref_get(BlockRef ref) {
+    return chunk_layer_get_block(ref.layer, ref.idx);
+}
+
+void* block_ref_get_data(BlockRef ref) {
+    return chunk_layer_get_data(ref.layer, ref.idx);
+}
+
+bool block_ref_set_data(BlockRef ref, void* data) {
+    return chunk_layer_set_data(ref.layer, ref.idx, data);
+}
+
+void* block_ref_alloc_data(BlockRef ref, size_t size) {
+    return chunk_layer_alloc_data(ref.layer, size);
+}
+
+static bool cell_is_set(const uint32_t* cells, int i) {
+    return (cells[i / 32] >> (i % 32)) & 1;
+}
 
-    // Now generate the quads for the mesh
+// Writes the vertices of the blocks into the mesh buffers, which must already be allocated with the layout in offsets.
+// If cells isn't NULL, the blocks on the other cells are skipped.
+static void chunk_layer_gen_vertices(ChunkLayer* layer, const uint32_t* cells, size_t* offsets, Mesh* mesh, ChunkLayerEnum layer_id, ChunkLayerEnum front_layer_id, Chunk* chunk, unsigned int chunk_pos_seed, uint8_t brightness) {
     for (int i = 0; i < CHUNK_AREA; i++) {
-        BlockInstance block = layer->blocks[i];
-        BlockRegistry* brg = br_get_block_registry(block.id);
+        if (cells && !cell_is_set(cells, i)) continue;
+
+        uint8_t id = layer->ids[i];
+        if (id <= 0) continue;
 
-        if (block.id <= 0 || brg->flags & BLOCK_FLAG_LIQUID) continue;
+        BlockRegistry* brg = br_get_block_registry(id);
+        if (brg->flags & BLOCK_FLAG_LIQUID) continue;
         
         int x = i % CHUNK_WIDTH;
         int y = i / CHUNK_WIDTH;
@@ -143,7 +258,7 @@ void chunk_layer_genmesh(ChunkLayer* layer, ChunkLayerEnum layer_id, ChunkLayerE
             }
         }
 
-        BlockVariant bvar = brg->variant_generator(block.state);
+        BlockVariant bvar = br_get_block_variant(id, layer->states[i])->variant;
 
         Color colors[4];
         for (int i = 0; i < 4; i++) {
@@ -164,14 +279,15 @@ void chunk_layer_genmesh(ChunkLayer* layer, ChunkLayerEnum layer_id, ChunkLayerE
         h ^= y * TILE_SIZE * 668265263u;
         h = (h ^ (h >> 13)) * 1274126177u;
 
-        srand(h);
+        // Not using rand() here since the meshes are built on multiple threads at once
+        h = (h ^ (h >> 16)) * 2246822519u;
 
-        bool flipUVH = (brg->flags & BLOCK_FLAG_FLIP_H) && (rand() % 2) ? true : false;
-        bool flipUVV = (brg->flags & BLOCK_FLAG_FLIP_V) && (rand() % 2) ? true : false;
+        bool flipUVH = (brg->flags & BLOCK_FLAG_FLIP_H) && ((h >> 7) & 1) ? true : false;
+        bool flipUVV = (brg->flags & BLOCK_FLAG_FLIP_V) && ((h >> 19) & 1) ? true : false;
 
         bm_set_block_model(
-            layer->vertexOffsets,
-            &layer->mesh,
+            offsets,
+            mesh,
             (Vector2u) { x, y },
             colors,
             bvar,
@@ -179,50 +295,265 @@ void chunk_layer_genmesh(ChunkLayer* layer, ChunkLayerEnum layer_id, ChunkLayerE
             flipUVV
         );
     }
+}
+
+bool chunk_layer_build_mesh_data(ChunkLayer* layer, ChunkLayerEnum layer_id, ChunkLayerEnum front_layer_id, void* c, unsigned int chunk_pos_seed, uint8_t brightness, const uint32_t* cells, ChunkLayerMeshData* out) {
+    if (!layer || !c || !out) return false;
+    Chunk* chunk = (Chunk*)c;
+
+    // Get total amount of vertices needed
+    int vertexCount = 0;
+    for (int i = 0; i < CHUNK_AREA; i++) {
+        out->vertexOffsets[i] = vertexCount;
+        vertexCount += br_get_block_variant(layer->ids[i], layer->states[i])->vertex_count;
+    }
+
+    out->vertexCount = vertexCount;
+    out->partial = cells != NULL;
+    if (cells) memcpy(out->cells, cells, sizeof(out->cells));
+
+    // Layers with nothing to show (like the ones that are all air) don't need any buffers
+    if (vertexCount == 0) return true;
+
+    if (cells) {
+        bool anyCell = false;
+        for (int w = 0; w < CHUNK_AREA / 32; w++) {
+            if (cells[w]) anyCell = true;
+        }
+        // Nothing changed, the current mesh already has every cell
+        if (!anyCell) return true;
+    }
+
+    out->vertices = (float*)MemAlloc(vertexCount * 3 * sizeof(float));
+    out->texcoords = (float*)MemAlloc(vertexCount * 2 * sizeof(float));
+    out->colors = (unsigned char*)MemAlloc(vertexCount * 4 * sizeof(unsigned char));
+
+    if (!out->vertices || !out->texcoords || !out->colors) {
+        chunk_layer_free_mesh_data(out);
+        return false;
+    }
+
+    Mesh target = {
+        .vertexCount = vertexCount,
+        .vertices = out->vertices,
+        .texcoords = out->texcoords,
+        .colors = out->colors
+    };
+    chunk_layer_gen_vertices(layer, cells, out->vertexOffsets, &target, layer_id, front_layer_id, chunk, chunk_pos_seed, brightness);
 
-    UploadMesh(&layer->mesh, false);
+    return true;
 }
 
-void chunk_layer_draw(ChunkLayer* layer) {
-    if (!layer) return;
+// Sends only the ranges of the blocks whose vertices changed. Adjacent ranges are merged so there are less buffer updates.
+// Cells that weren't generated are left as they are.
+static void chunk_layer_update_mesh(ChunkLayerMesh* layerMesh, ChunkLayerMeshData* data) {
+    Mesh* mesh = &layerMesh->mesh;
+    int vertexCount = mesh->vertexCount;
+
+    int rangeStart = -1;
+    int rangeEnd = -1;
+
+    for (int i = 0; i <= CHUNK_AREA; i++) {
+        bool changed = false;
+        int start = 0;
+        int end = 0;
+
+        if (i < CHUNK_AREA) {
+            start = (int)layerMesh->vertexOffsets[i];
+            end = i + 1 < CHUNK_AREA ? (int)layerMesh->vertexOffsets[i + 1] : vertexCount;
+
+            if (end > start && (!data->partial || cell_is_set(data->cells, i))) {
+                changed =
+                    memcmp(mesh->vertices + start * 3, data->vertices + start * 3, (end - start) * 3 * sizeof(float)) != 0 ||
+                    memcmp(mesh->texcoords + start * 2, data->texcoords + start * 2, (end - start) * 2 * sizeof(float)) != 0 ||
+                    memcmp(mesh->colors + start * 4, data->colors + start * 4, (end - start) * 4 * sizeof(unsigned char)) != 0;
+            }
+        }
 
-    rlDrawRenderBatchActive();
+        if (changed) {
+            if (rangeStart < 0) rangeStart = start;
+            rangeEnd = end;
+            continue;
+        }
+
+        // Empty blocks don't break the range
+        if (i < CHUNK_AREA && end == start) continue;
+
+        if (rangeStart >= 0) {
+            int count = rangeEnd - rangeStart;
 
-    if (layer->initializedMesh) {
-        DrawMesh(layer->mesh, texture_atlas_get_material(), MatrixIdentity());
+            memcpy(mesh->vertices + rangeStart * 3, data->vertices + rangeStart * 3, count * 3 * sizeof(float));
+            memcpy(mesh->texcoords + rangeStart * 2, data->texcoords + rangeStart * 2, count * 2 * sizeof(float));
+            memcpy(mesh->colors + rangeStart * 4, data->colors + rangeStart * 4, count * 4 * sizeof(unsigned char));
+
+            UpdateMeshBuffer(*mesh, 0, mesh->vertices + rangeStart * 3, count * 3 * sizeof(float), rangeStart * 3 * sizeof(float));
+            UpdateMeshBuffer(*mesh, 1, mesh->texcoords + rangeStart * 2, count * 2 * sizeof(float), rangeStart * 2 * sizeof(float));
+            UpdateMeshBuffer(*mesh, 3, mesh->colors + rangeStart * 4, count * 4 * sizeof(unsigned char), rangeStart * 4 * sizeof(unsigned char));
+            rangeStart = -1;
+        }
     }
+}
+
+// Copies the cells that weren't generated from the current mesh into the new buffers.
+// Those cells still have the same blocks, so they must have the same amount of vertices as before.
+static bool chunk_layer_copy_kept_cells(ChunkLayerMesh* layerMesh, ChunkLayerMeshData* data) {
+    if (!data->vertices) return false;
+    Mesh* mesh = &layerMesh->mesh;
 
     for (int i = 0; i < CHUNK_AREA; i++) {
-        BlockInstance* block = &layer->blocks[i];
-        if (!block->data) continue;
-        BlockRegistry* rg = br_get_block_registry(block->id);
+        if (cell_is_set(data->cells, i)) continue;
+
+        int start = (int)data->vertexOffsets[i];
+        int count = (i + 1 < CHUNK_AREA ? (int)data->vertexOffsets[i + 1] : data->vertexCount) - start;
+        if (count == 0) continue;
+        if (!layerMesh->initializedMesh) return false;
+
+        int oldStart = (int)layerMesh->vertexOffsets[i];
+        int oldCount = (i + 1 < CHUNK_AREA ? (int)layerMesh->vertexOffsets[i + 1] : mesh->vertexCount) - oldStart;
+        if (oldCount != count) return false;
+
+        memcpy(data->vertices + start * 3, mesh->vertices + oldStart * 3, count * 3 * sizeof(float));
+        memcpy(data->texcoords + start * 2, mesh->texcoords + oldStart * 2, count * 2 * sizeof(float));
+        memcpy(data->colors + start * 4, mesh->colors + oldStart * 4, count * 4 * sizeof(unsigned char));
+    }
+
+    return true;
+}
+
+bool chunk_layer_apply_mesh_data(ChunkLayerMesh* layerMesh, ChunkLayerMeshData* data) {
+    if (!layerMesh || !data) return false;
+
+    // If no block changed its amount of vertices, the mesh can be updated in place
+    if (layerMesh->initializedMesh && layerMesh->mesh.vertexCount == data->vertexCount && data->vertexCount > 0 &&
+        memcmp(data->vertexOffsets, layerMesh->vertexOffsets, sizeof(data->vertexOffsets)) == 0) {
+        // Partial data comes without buffers when none of its cells has vertices
+        if (data->vertices) chunk_layer_update_mesh(layerMesh, data);
+        chunk_layer_free_mesh_data(data);
+        return true;
+    }
+
+    if (data->partial && data->vertexCount > 0 && !chunk_layer_copy_kept_cells(layerMesh, data)) {
+        chunk_layer_free_mesh_data(data);
+        return false;
+    }
+
+    if (layerMesh->initializedMesh == true) {
+        UnloadMesh(layerMesh->mesh);
+        layerMesh->initializedMesh = false;
+    }
+
+    // Nothing to draw, so the layer goes without a mesh until it has some blocks to show
+    if (data->vertexCount == 0) {
+        chunk_layer_free_mesh_data(data);
+        return true;
+    }
+
+    // The mesh takes the buffers, so they will be freed with it
+    memcpy(layerMesh->vertexOffsets, data->vertexOffsets, sizeof(data->vertexOffsets));
+    layerMesh->mesh = (Mesh){0};
+    layerMesh->mesh.vertexCount = data->vertexCount;
+    layerMesh->mesh.triangleCount = data->vertexCount * 3;
+    layerMesh->mesh.vertices = data->vertices;
+    layerMesh->mesh.texcoords = data->texcoords;
+    layerMesh->mesh.colors = data->colors;
+    layerMesh->initializedMesh = true;
+
+    data->vertices = NULL;
+    data->texcoords = NULL;
+    data->colors = NULL;
+
+    // Uploaded as dynamic since it will probably be updated in place later
+    UploadMesh(&layerMesh->mesh, true);
+    return true;
+}
+
+void chunk_layer_free_mesh_data(ChunkLayerMeshData* data) {
+    if (!data) return;
+
+    if (data->vertices) MemFree(data->vertices);
+    if (data->texcoords) MemFree(data->texcoords);
+    if (data->colors) MemFree(data->colors);
+
+    data->vertices = NULL;
+    data->texcoords = NULL;
+    data->colors = NULL;
+}
+
+void chunk_layer_genmesh(ChunkLayer* layer, ChunkLayerMesh* mesh, ChunkLayerEnum layer_id, ChunkLayerEnum front_layer_id, void* c, unsigned int chunk_pos_seed, uint8_t brightness) {
+    ChunkLayerMeshData data = { 0 };
+    if (!chunk_layer_build_mesh_data(layer, layer_id, front_layer_id, c, chunk_pos_seed, brightness, NULL, &data)) return;
+    chunk_layer_apply_mesh_data(mesh, &data);
+}
+
+void chunk_layer_draw(ChunkLayer* layer, ChunkLayerMesh* mesh) {
+    if (!layer || !mesh) return;
+
+    rlDrawRenderBatchActive();
+
+    if (mesh->initializedMesh) {
+        DrawMesh(mesh->mesh, texture_atlas_get_material(), MatrixIdentity());
+    }
+
+    for (int d = 0; d < layer->dataCount; d++) {
+        BlockDataEntry entry = layer->data[d];
+        BlockRegistry* rg = br_get_block_registry(layer->ids[entry.idx]);
         if (rg->overlay_draw) {
-            int x = i % CHUNK_WIDTH;
-            int y = i / CHUNK_WIDTH;
+            int x = entry.idx % CHUNK_WIDTH;
+            int y = entry.idx / CHUNK_WIDTH;
 
-            rg->overlay_draw(block->data, (Vector2) { x * TILE_SIZE, y * TILE_SIZE }, block->state);
+            rg->overlay_draw(entry.data, (Vector2) { x * TILE_SIZE, y * TILE_SIZE }, layer->states[entry.idx]);
         }
     }
 }
 
-void chunk_layer_free_mesh(ChunkLayer *layer) {
-    if (!layer) return;
+void chunk_layer_free_mesh(ChunkLayerMesh* mesh) {
+    if (!mesh) return;
 
-    if (layer->initializedMesh) {
-        UnloadMesh(layer->mesh);
-        layer->initializedMesh = false;
+    if (mesh->initializedMesh) {
+        UnloadMesh(mesh->mesh);
+        mesh->initializedMesh = false;
     }
 }
 
 void chunk_layer_free_block_data(ChunkLayer* layer) {
     if (!layer) return;
 
-    for (int i = 0; i < CHUNK_AREA; i++) {
-        BlockInstance* block = &layer->blocks[i];
-        if (!block->data) continue;
-        BlockRegistry* rg = br_get_block_registry(block->id);
+    for (int d = 0; d < layer->dataCount; d++) {
+        BlockRegistry* rg = br_get_block_registry(layer->ids[layer->data[d].idx]);
         if (rg->free_data) {
-            rg->free_data(block->data);
+            rg->free_data(layer->data[d].data);
         }
     }
+
+    arena_free(&layer->arena);
+    chunk_layer_forget_block_data(layer);
+}
+
+void chunk_layer_forget_block_data(ChunkLayer* layer) {
+    if (!layer) return;
+
+    free(layer->data);
+    layer->data = NULL;
+    layer->dataCount = 0;
+    layer->dataCapacity = 0;
+    layer->arena = (Arena) { 0 };
+    layer->deadData = 0;
+}
+
+void chunk_layer_move_blocks(ChunkLayer* dst, ChunkLayer* src) {
+    if (!dst || !src) return;
+
+    memcpy(dst->ids, src->ids, sizeof(src->ids));
+    memcpy(dst->states, src->states, sizeof(src->states));
+    dst->data = src->data;
+    dst->dataCount = src->dataCount;
+    dst->dataCapacity = src->dataCapacity;
+    dst->arena = src->arena;
+    dst->deadData = src->deadData;
+
+    src->data = NULL;
+    src->dataCount = 0;
+    src->dataCapacity = 0;
+    src->arena = (Arena) { 0 };
+    src->deadData = 0;
 }
\ No newline at end of file
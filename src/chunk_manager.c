@@ -1,13 +1,18 @@
 ﻿#include "chunk_manager.h"
 #include "chunk_layer.h"
+#include "chunk_codec.h"
 #include "game.h"
+#include "game_settings.h"
 #include "registries/block_registry.h"
+#include "registries/block_models.h"
 #include "chunk.h"
 #include "types.h"
 #include "world_manager.h"
+#include "worker_pool.h"
 
 #include <stdlib.h>
 #include <limits.h>
+#include <float.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <memory.h>
@@ -24,333 +29,1379 @@ static uint8_t chunk_view_width = 5;
 static uint8_t chunk_view_height = 3;
 static size_t chunk_count = 0;
 
-static Chunk* chunks = NULL;
+// Every slot of the view points to its own chunk, so the chunks never move in memory
+// and changing the size of the view only has to move the pointers.
+static Chunk** chunks = NULL;
 static Vector2i currentChunkPos = { 0, 0 };
 
 static unsigned int tick_counter = 0;
 
+// How far (in blocks) a light change can spread from the cell that caused it
+#define LIGHT_UPDATE_RADIUS 15
+
+// Cells (in global block coordinates) that changed and still need their light updated
+static Vector2i* dirty_cells = NULL;
+static size_t dirty_cell_count = 0;
+static size_t dirty_cell_capacity = 0;
+
+// While ticking, changes are only recorded and then applied all at once at the end
+static bool defer_changes = false;
+
+// Mesh jobs that can be running per worker thread at the same time
+#define MESH_JOBS_PER_THREAD 2
+#define MAX_MESH_JOBS 64
+
+typedef struct {
+    // Copies of the chunk (at the center, index 4) and its 8 neighbors
+    Chunk snapshot[9];
+    // What the current mesh of the chunk was built from, so only the cells that changed since are built
+    ChunkMeshInputs previous;
+    ChunkMeshData data;
+    bool built;
+} ChunkMeshJob;
+
+static WorkerPool* mesh_pool = NULL;
+// Positions of the chunks that have a mesh job running
+static Vector2i mesh_job_positions[MAX_MESH_JOBS];
+static int mesh_job_count = 0;
+static bool discard_mesh_jobs = false;
+
+typedef struct {
+    // Private chunk the blocks are loaded into, so the worker never touches the loaded ones
+    Chunk chunk;
+    ChunkLoadStatus status;
+    // Copy of the loadRequest of the chunk when the job was submitted
+    unsigned int request;
+    bool demo;
+} ChunkLoadJob;
+
+static WorkerPool* load_pool = NULL;
+static bool discard_load_jobs = false;
+static unsigned int load_request_counter = 0;
+
 typedef struct {
     Vector2i key;
-    ChunkLayer layers[CHUNK_LAYER_COUNT];
+    // The chunk serialized when the save was queued
+    ByteWriter record;
+    bool saved;
+    // Only the newest save of each position stays in the pending table
+    bool pending;
+    UT_hash_handle hh;
+} ChunkSaveJob;
+
+// A single thread writes the saves, so they reach the disk in the same order they were queued
+static WorkerPool* save_pool = NULL;
+// Saves that weren't written yet, so a chunk that comes back meanwhile is loaded from them instead of the disk
+static ChunkSaveJob* pendingSaves = NULL;
+// Saves were written since the last commit (see world_manager_commit_chunks)
+static bool saves_uncommitted = false;
+
+// Placing or interacting with some blocks opens a UI (chest contents, sign text) that changes their data
+// while it is open, so the chunk of the block is kept modified until the UI closes.
+static Vector2i block_ui_chunk = { 0, 0 };
+static bool block_ui_open = false;
+
+// A copy of the world info, written on the save thread after the chunks of the autosave it belongs to
+typedef struct {
+    char worldDir[512];
+    WorldInfo info;
+} WorldInfoSaveJob;
+
+// Waits for the running autosave to queue its last chunk
+static WorldInfoSaveJob* pending_world_info = NULL;
+
+// Time (from GetTime) of the last autosave
+static double last_autosave_time = 0.0;
+// The cache entries are written a few at a time, over as many frames as needed
+static bool autosave_running = false;
+#define AUTOSAVE_FRAME_BUDGET 0.001
+
+// Data of a block (chest contents, sign text...) that stays alive while its chunk is cached
+typedef struct {
+    void* data;
+    // Id of the block, needed to know how to free the data
+    uint8_t id;
+    uint8_t layer;
+    uint8_t idx;
+} CachedBlockData;
+
+typedef struct {
+    Vector2i key;
+    // Blocks encoded with chunk_codec. Uniform chunks (all air, all stone...) only keep the one block instead.
+    uint8_t* blocks;
+    size_t blocksSize;
+    BlockInstance uniformBlock;
+    bool uniform;
+    CachedBlockData* data;
+    uint16_t dataCount;
+    // The memory the block data was allocated from, taken from the layers along with the data
+    Arena arenas[CHUNK_LAYER_COUNT];
+    // How much removed data the arenas still have, so the layers know when to compact them again
+    int deadData[CHUNK_LAYER_COUNT];
+    // The blocks are different from what is on the disk, so they have to be saved before being dropped
+    bool dirty;
     UT_hash_handle hh;
 } ChunkCacheEntry;
 
+// uthash keeps the entries in insertion order, and a hit takes the entry out of the cache,
+// so the first entry is always the least recently used one.
 static ChunkCacheEntry* chunkCache = NULL;
+static size_t cache_bytes = 0;
+static unsigned int cache_hits = 0;
+static unsigned int cache_misses = 0;
+static unsigned int cache_evictions = 0;
+static int cache_dirty_count = 0;
+
+// Frees the chunk objects and the array holding them. What is inside the chunks must be freed before.
+static void free_chunks(Chunk** list, size_t count) {
+    if (!list) return;
+    for (size_t c = 0; c < count; c++) free(list[c]);
+    free(list);
+}
 
 void chunk_manager_init(Vector2i center, uint8_t cvw, uint8_t cvh) {
     chunk_view_width = cvw;
     chunk_view_height = cvh;
     chunk_count = chunk_view_width * chunk_view_height;
 
-    chunks = (Chunk*)malloc(sizeof(Chunk) * chunk_count);
+    chunks = (Chunk**)calloc(chunk_count, sizeof(Chunk*));
     if (!chunks) {
         TraceLog(LOG_ERROR, "Failed to allocate memory for the Chunks.\n");
         return;
     }
 
-    for (size_t c = 0; c < chunk_count; c++) chunks[c].initialized = false;
+    for (size_t c = 0; c < chunk_count; c++) {
+        chunks[c] = (Chunk*)calloc(1, sizeof(Chunk));
+        if (!chunks[c]) {
+            TraceLog(LOG_ERROR, "Failed to allocate memory for the Chunks.\n");
+            free_chunks(chunks, c);
+            chunks = NULL;
+            return;
+        }
+    }
+
+    if (!mesh_pool) {
+        mesh_pool = worker_pool_create(0);
+        if (!mesh_pool) TraceLog(LOG_WARNING, "Could not start the chunk meshing threads. Meshes will be built on the main thread.");
+    }
+
+    // Loading is mostly waiting for the disk, so it gets its own threads instead of competing with the meshing ones
+    if (!load_pool) {
+        load_pool = worker_pool_create(worker_pool_get_cpu_count() / 2);
+        if (!load_pool) TraceLog(LOG_WARNING, "Could not start the chunk loading threads. Chunks will be loaded on the main thread.");
+    }
+
+    if (!save_pool) {
+        save_pool = worker_pool_create(1);
+        if (!save_pool) TraceLog(LOG_WARNING, "Could not start the chunk saving thread. Chunks will be saved on the main thread.");
+    }
+
+    last_autosave_time = GetTime();
+    autosave_running = false;
 
     initialized = true;
 
 	chunk_manager_relocate(center);
+
+    // Load and build everything right away so the world doesn't show up piece by piece
+    chunk_manager_finish_loading();
+    chunk_manager_update_meshes(Vector2Zero(), 0.0);
+}
+
+static void watch_block_ui(Chunk* chunk) {
+    if (!block_ui_open && game_is_ui_open()) {
+        block_ui_chunk = chunk->position;
+        block_ui_open = true;
+    }
+}
+
+static void update_block_ui() {
+    if (!block_ui_open) return;
+
+    Chunk* chunk = chunk_manager_get_chunk(block_ui_chunk);
+    if (chunk && chunk->state != CHUNK_STATE_REQUESTED) chunk->modified = true;
+
+    if (!game_is_ui_open()) block_ui_open = false;
+}
+
+// Runs on the save thread
+static void save_job_work(void* data) {
+    ChunkSaveJob* job = data;
+    job->saved = world_manager_write_chunk_record(job->key, job->record.data, job->record.size);
+}
+
+static void keep_failed_save(ChunkSaveJob* job);
+
+// Runs on the main thread when polling the pool
+static void save_job_done(void* data) {
+    ChunkSaveJob* job = data;
+    saves_uncommitted = true;
+    if (job->pending) HASH_DEL(pendingSaves, job);
+    // The chunk was already marked as saved when the save was queued, so it has to be marked again.
+    // Saves that aren't pending anymore have a newer one queued after them, or were saved right away by the caller.
+    if (!job->saved && job->pending) keep_failed_save(job);
+    byte_writer_free(&job->record);
+    free(job);
+}
+
+// Serializes the chunk right away and leaves the writing to the save thread.
+// Returns false if the chunk couldn't be serialized (or written, when there is no save thread).
+static bool queue_chunk_save(Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    ChunkSaveJob* job = calloc(1, sizeof(ChunkSaveJob));
+    if (!job) {
+        TraceLog(LOG_ERROR, "Could not allocate memory for a chunk save job, saving chunk (%d, %d) right away.", position.x, position.y);
+        return world_manager_save_chunk(position, layers);
+    }
+
+    job->key = position;
+    if (!world_manager_serialize_chunk(layers, &job->record)) {
+        TraceLog(LOG_ERROR, "Could not serialize chunk (%d, %d).", position.x, position.y);
+        byte_writer_free(&job->record);
+        free(job);
+        return false;
+    }
+
+    if (save_pool) {
+        ChunkSaveJob* older;
+        HASH_FIND(hh, pendingSaves, &position, sizeof(Vector2i), older);
+        if (older) {
+            HASH_DEL(pendingSaves, older);
+            older->pending = false;
+        }
+
+        job->pending = true;
+        HASH_ADD(hh, pendingSaves, key, sizeof(Vector2i), job);
+        if (worker_pool_submit(save_pool, save_job_work, save_job_done, job)) return true;
+
+        // Anything older that is still queued gets written before this one, since the queue is waited first
+        TraceLog(LOG_WARNING, "Could not queue the save of chunk (%d, %d), saving it right away.", position.x, position.y);
+        HASH_DEL(pendingSaves, job);
+        job->pending = false;
+        worker_pool_wait(save_pool);
+        worker_pool_poll(save_pool, 0);
+    }
+
+    save_job_work(job);
+    bool saved = job->saved;
+    save_job_done(job);
+    return saved;
+}
+
+// Waits until every queued save is on the disk.
+static void finish_save_jobs() {
+    if (save_pool) {
+        worker_pool_wait(save_pool);
+        worker_pool_poll(save_pool, 0);
+    }
+
+    world_manager_commit_chunks();
+    saves_uncommitted = false;
+}
+
+static void commit_job_work(void* data) {
+    (void)data;
+    world_manager_commit_chunks();
+}
+
+// Committing syncs the files, so the saves are committed together once the queue runs out
+// (and the autosave is over), instead of one by one. It's queued after them on the save thread.
+static void commit_finished_saves() {
+    if (!saves_uncommitted || autosave_running) return;
+    if (save_pool && worker_pool_get_pending_count(save_pool) > 0) return;
+
+    saves_uncommitted = false;
+    if (!save_pool || !worker_pool_submit(save_pool, commit_job_work, NULL, NULL)) world_manager_commit_chunks();
+}
+
+// Runs on the save thread
+static void world_info_job_work(void* data) {
+    WorldInfoSaveJob* job = data;
+    world_manager_write_world_info(job->worldDir, &job->info);
+}
+
+static void world_info_job_done(void* data) {
+    free(data);
+}
+
+// Queues the world info after every chunk save queued so far, like queue_chunk_save.
+static void queue_world_info_save(WorldInfoSaveJob* job) {
+    if (save_pool) {
+        if (worker_pool_submit(save_pool, world_info_job_work, world_info_job_done, job)) return;
+
+        TraceLog(LOG_WARNING, "Could not queue the save of the world info, saving it right away.");
+        worker_pool_wait(save_pool);
+        worker_pool_poll(save_pool, 0);
+    }
+
+    world_info_job_work(job);
+    world_info_job_done(job);
+}
+
+static void queue_pending_world_info() {
+    if (!pending_world_info) return;
+    queue_world_info_save(pending_world_info);
+    pending_world_info = NULL;
+}
+
+void chunk_manager_save_world_info() {
+    const char* worldDir = world_manager_get_world_dir();
+    if (!worldDir) {
+        TraceLog(LOG_ERROR, "Could not save world info: no world is currently loaded.");
+        return;
+    }
+
+    WorldInfoSaveJob* job = malloc(sizeof(WorldInfoSaveJob));
+    if (!job) {
+        TraceLog(LOG_ERROR, "Could not allocate memory for a world info save job, saving it right away.");
+        world_manager_save_world_info();
+        return;
+    }
+
+    snprintf(job->worldDir, sizeof(job->worldDir), "%s", worldDir);
+    job->info = *get_world_info();
+
+    // A newer copy replaces the one that is still waiting
+    free(pending_world_info);
+    pending_world_info = job;
+    if (!autosave_running) queue_pending_world_info();
+}
+
+// Loads the chunk from a save that is still waiting to be written, since the disk doesn't have it yet.
+static bool load_chunk_from_pending_save(Chunk* chunk, ChunkLoadStatus* status) {
+    ChunkSaveJob* job;
+    HASH_FIND(hh, pendingSaves, &chunk->position, sizeof(Vector2i), job);
+    if (!job) return false;
+
+    *status = world_manager_deserialize_chunk(chunk->position, job->record.data, job->record.size, chunk->layers);
+    return true;
+}
+
+static size_t cache_entry_size(ChunkCacheEntry* cacheEntry) {
+    size_t size = sizeof(ChunkCacheEntry) + cacheEntry->blocksSize + sizeof(CachedBlockData) * cacheEntry->dataCount;
+    for (int l = 0; l < CHUNK_LAYER_COUNT; l++) size += arena_get_size(&cacheEntry->arenas[l]);
+    return size;
+}
+
+// Compresses the blocks of the layers into a new cache entry. The block data is moved to the entry.
+static ChunkCacheEntry* create_cache_entry(Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    ChunkCacheEntry* cacheEntry = calloc(1, sizeof(ChunkCacheEntry));
+    if (!cacheEntry) return NULL;
+    cacheEntry->key = position;
+
+    if (chunk_codec_is_uniform(layers, &cacheEntry->uniformBlock)) {
+        cacheEntry->uniform = true;
+        // Uniform chunks have no block data, so nothing in the arenas is used anymore
+        for (int l = 0; l < CHUNK_LAYER_COUNT; l++) chunk_layer_free_block_data(&layers[l]);
+        return cacheEntry;
+    }
+
+    uint8_t encoded[CHUNK_CODEC_MAX_SIZE];
+    size_t size = chunk_codec_encode(layers, encoded);
+
+    int dataCount = 0;
+    for (int l = 0; l < CHUNK_LAYER_COUNT; l++) dataCount += layers[l].dataCount;
+
+    cacheEntry->blocks = malloc(size);
+    cacheEntry->data = dataCount > 0 ? malloc(sizeof(CachedBlockData) * dataCount) : NULL;
+    if (!cacheEntry->blocks || (dataCount > 0 && !cacheEntry->data)) {
+        free(cacheEntry->blocks);
+        free(cacheEntry->data);
+        free(cacheEntry);
+        return NULL;
+    }
+
+    memcpy(cacheEntry->blocks, encoded, size);
+    cacheEntry->blocksSize = size;
+
+    for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+        for (int d = 0; d < layers[l].dataCount; d++) {
+            BlockDataEntry entry = layers[l].data[d];
+            cacheEntry->data[cacheEntry->dataCount++] = (CachedBlockData) { entry.data, layers[l].ids[entry.idx], (uint8_t)l, entry.idx };
+        }
+        cacheEntry->arenas[l] = layers[l].arena;
+        cacheEntry->deadData[l] = layers[l].deadData;
+        chunk_layer_forget_block_data(&layers[l]);
+    }
+
+    return cacheEntry;
+}
+
+// Decompresses the blocks of the entry into the layers, data and arenas included. The layers must not have any data.
+// The entry still has the data too, so either the entry is removed without freeing it, or the layers forget it.
+static bool expand_cache_entry(ChunkCacheEntry* cacheEntry, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    if (cacheEntry->uniform) {
+        for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+            memset(layers[l].ids, cacheEntry->uniformBlock.id, sizeof(layers[l].ids));
+            memset(layers[l].states, cacheEntry->uniformBlock.state, sizeof(layers[l].states));
+        }
+        return true;
+    }
+
+    if (!chunk_codec_decode(cacheEntry->blocks, cacheEntry->blocksSize, layers)) return false;
+
+    for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+        layers[l].arena = cacheEntry->arenas[l];
+        layers[l].deadData = cacheEntry->deadData[l];
+    }
+    for (int d = 0; d < cacheEntry->dataCount; d++) {
+        CachedBlockData* bd = &cacheEntry->data[d];
+        if (!chunk_layer_set_data(&layers[bd->layer], bd->idx, bd->data)) {
+            for (int l = 0; l < CHUNK_LAYER_COUNT; l++) chunk_layer_forget_block_data(&layers[l]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void remove_cache_entry(ChunkCacheEntry* cacheEntry, bool free_block_data) {
+    // The size counts the arenas, so it has to be taken before they are freed
+    HASH_DEL(chunkCache, cacheEntry);
+    cache_bytes -= cache_entry_size(cacheEntry);
+    if (cacheEntry->dirty) cache_dirty_count--;
+
+    if (free_block_data) {
+        for (int d = 0; d < cacheEntry->dataCount; d++) {
+            BlockRegistry* rg = br_get_block_registry(cacheEntry->data[d].id);
+            if (rg && rg->free_data) rg->free_data(cacheEntry->data[d].data);
+        }
+        for (int l = 0; l < CHUNK_LAYER_COUNT; l++) arena_free(&cacheEntry->arenas[l]);
+    }
+
+    free(cacheEntry->blocks);
+    free(cacheEntry->data);
+    free(cacheEntry);
+}
+
+// Layers the cache entries are expanded into before being saved. Only used on the main thread.
+static ChunkLayer save_layers[CHUNK_LAYER_COUNT];
+
+static bool save_cache_entry(ChunkCacheEntry* cacheEntry) {
+    if (!expand_cache_entry(cacheEntry, save_layers)) return false;
+    bool saved = queue_chunk_save(cacheEntry->key, save_layers);
+
+    // The data still belongs to the entry
+    for (int l = 0; l < CHUNK_LAYER_COUNT; l++) chunk_layer_forget_block_data(&save_layers[l]);
+    if (!saved) return false;
+
+    cacheEntry->dirty = false;
+    cache_dirty_count--;
+    return true;
+}
+
+// Drops the least recently used chunks until the cache fits in the budget from the settings.
+// Dirty chunks are written back to the disk first.
+static void trim_chunk_cache() {
+    size_t budget = (size_t)get_game_settings()->chunk_cache_mb * 1024 * 1024;
+
+    while (chunkCache && cache_bytes > budget) {
+        ChunkCacheEntry* oldest = chunkCache;
+        if (oldest->dirty && !save_cache_entry(oldest)) {
+            TraceLog(LOG_WARNING, "Could not write back chunk (%d, %d), the chunk cache will stay over its budget.", oldest->key.x, oldest->key.y);
+            break;
+        }
+
+        remove_cache_entry(oldest, true);
+        cache_evictions++;
+    }
+}
+
+// Marks the chunk of a save that couldn't be written as not saved, so the next autosave tries again.
+// If the chunk isn't loaded or cached anymore, the record is the only copy left, so it goes back to the cache.
+static void keep_failed_save(ChunkSaveJob* job) {
+    TraceLog(LOG_WARNING, "Chunk (%d, %d) could not be written, it will be saved again.", job->key.x, job->key.y);
+
+    Chunk* chunk = chunk_manager_get_chunk(job->key);
+    if (chunk && chunk->initialized && chunk->state != CHUNK_STATE_REQUESTED) {
+        chunk->modified = true;
+        return;
+    }
+
+    ChunkCacheEntry* cacheEntry;
+    HASH_FIND(hh, chunkCache, &job->key, sizeof(Vector2i), cacheEntry);
+    if (cacheEntry) {
+        if (!cacheEntry->dirty) {
+            cacheEntry->dirty = true;
+            cache_dirty_count++;
+        }
+        return;
+    }
+
+    ChunkLayer layers[CHUNK_LAYER_COUNT];
+    memset(layers, 0, sizeof(layers));
+    if (world_manager_deserialize_chunk(job->key, job->record.data, job->record.size, layers) != CHUNK_LOAD_SUCCESS) return;
+
+    cacheEntry = create_cache_entry(job->key, layers);
+    if (!cacheEntry) {
+        TraceLog(LOG_ERROR, "Could not allocate memory for the chunk cache, the changes of chunk (%d, %d) are lost.", job->key.x, job->key.y);
+        for (int l = 0; l < CHUNK_LAYER_COUNT; l++) chunk_layer_free_block_data(&layers[l]);
+        return;
+    }
+
+    // The cache isn't trimmed here, so the save isn't tried again right away
+    cacheEntry->dirty = true;
+    cache_dirty_count++;
+    HASH_ADD(hh, chunkCache, key, sizeof(Vector2i), cacheEntry);
+    cache_bytes += cache_entry_size(cacheEntry);
 }
 
 void move_chunk_to_cache(Chunk* chunk) {
     if (chunk->initialized) {
-        if (!game_is_demo_mode()) {
+        // A chunk that didn't finish loading has nothing worth keeping
+        if (!game_is_demo_mode() && chunk->state != CHUNK_STATE_REQUESTED) {
             ChunkCacheEntry* cacheEntry;
             HASH_FIND(hh, chunkCache, &chunk->position, sizeof(Vector2i), cacheEntry);
-            if (cacheEntry == NULL) {
-                cacheEntry = malloc(sizeof(ChunkCacheEntry));
-                memset(cacheEntry, 0, sizeof(ChunkCacheEntry));
-                cacheEntry->key = chunk->position;
-                for (int i = 0; i < CHUNK_LAYER_COUNT; i++) {
-                    memcpy(cacheEntry->layers[i].blocks, chunk->layers[i].blocks, sizeof(BlockInstance) * CHUNK_AREA);
-                }
+            if (cacheEntry) {
+                // Take it out so it's added again as the most recently used
+                remove_cache_entry(cacheEntry, true);
+            }
+
+            cacheEntry = create_cache_entry(chunk->position, chunk->layers);
+            if (cacheEntry) {
+                cacheEntry->dirty = chunk->modified;
+                if (cacheEntry->dirty) cache_dirty_count++;
                 HASH_ADD(hh, chunkCache, key, sizeof(Vector2i), cacheEntry);
-            } else {
-                for (int i = 0; i < CHUNK_LAYER_COUNT; i++) {
-                    memcpy(cacheEntry->layers[i].blocks, chunk->layers[i].blocks, sizeof(BlockInstance) * CHUNK_AREA);
-                }
+                cache_bytes += cache_entry_size(cacheEntry);
+
+                trim_chunk_cache();
+            }
+            else {
+                TraceLog(LOG_ERROR, "Could not allocate memory for the chunk cache, saving chunk (%d, %d) right away.", chunk->position.x, chunk->position.y);
+                if (chunk->modified) queue_chunk_save(chunk->position, chunk->layers);
+                chunk_free_block_data(chunk);
             }
         } else {
             chunk_free_block_data(chunk);
         }
+        block_tick_list_free(&chunk->blockTickList);
         chunk_free_meshes(chunk);
     }
 }
 
-void load_chunk_or_generate(Chunk* chunk) {
-    // Check if the chunk is already on the cache
+static bool load_chunk_from_cache(Chunk* chunk) {
     ChunkCacheEntry* cacheEntry;
     HASH_FIND(hh, chunkCache, &chunk->position, sizeof(Vector2i), cacheEntry);
-    if (cacheEntry) {
-        for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
-            memcpy(chunk->layers[l].blocks, cacheEntry->layers[l].blocks, sizeof(BlockInstance) * CHUNK_AREA);
-        }
-        HASH_DEL(chunkCache, cacheEntry);
-        free(cacheEntry);
-    } else {
-        // Otherwise load from the disk
-        ChunkLoadStatus status = world_manager_load_chunk(
+    if (!cacheEntry) {
+        cache_misses++;
+        return false;
+    }
+
+    if (!expand_cache_entry(cacheEntry, chunk->layers)) {
+        TraceLog(LOG_ERROR, "Cached chunk (%d, %d) is corrupted, loading it from the disk instead.", chunk->position.x, chunk->position.y);
+        remove_cache_entry(cacheEntry, true);
+        chunk_layer_init(&chunk->layers[CHUNK_LAYER_BACKGROUND]);
+        chunk_layer_init(&chunk->layers[CHUNK_LAYER_FOREGROUND]);
+        cache_misses++;
+        return false;
+    }
+
+    // The block data now belongs to the chunk, along with any changes that weren't saved
+    chunk->modified = cacheEntry->dirty;
+    remove_cache_entry(cacheEntry, false);
+    cache_hits++;
+    return true;
+}
+
+// Loads the blocks from the disk, or generates them if the chunk was never saved.
+// It only touches the given chunk, so it can run on a worker thread.
+static ChunkLoadStatus load_chunk_or_generate(Chunk* chunk, bool demo) {
+    if (demo) {
+        chunk_regenerate(chunk);
+        return CHUNK_LOAD_SUCCESS;
+    }
+
+    // Most chunks that come into view were never saved, so the disk isn't even asked about them
+    ChunkLoadStatus status = CHUNK_LOAD_ERROR_NOT_FOUND;
+    if (world_manager_has_chunk(chunk->position)) {
+        status = world_manager_load_chunk(
             chunk->position,
             chunk->layers
         );
-        // If not on the disk then generate it
-        if (status == CHUNK_LOAD_ERROR_NOT_FOUND) {
-            chunk_regenerate(chunk);
-        } else if (status == CHUNK_LOAD_ERROR_FATAL) {
-            chunk_free_block_data(chunk);
-            chunk_free_meshes(chunk);
-        }
     }
+    // If not on the disk then generate it
+    if (status == CHUNK_LOAD_ERROR_NOT_FOUND) {
+        chunk_regenerate(chunk);
+        return CHUNK_LOAD_SUCCESS;
+    }
+    if (status == CHUNK_LOAD_ERROR_FATAL) {
+        chunk_free_block_data(chunk);
+    }
+    return status;
 }
 
-void chunk_manager_relocate(Vector2i newCenter) {
-    if (!initialized) return;
+// Relights the chunk and spreads the light of its neighbors into it, which also marks them to be remeshed.
+static void light_loaded_chunk(Chunk* chunk) {
+    Vector2i start = { chunk->position.x * CHUNK_WIDTH, chunk->position.y * CHUNK_WIDTH };
+    Vector2i end = { start.x + CHUNK_WIDTH - 1, start.y + CHUNK_WIDTH - 1 };
+
+    if (chunk->uniform) {
+        // Every cell gets the same light, so there is no need to go through all of them
+        chunk_queue_uniform_light(chunk);
+        chunk_propagate_light();
+        chunk_manager_remesh_area(
+            (Vector2i) { start.x - LIGHT_UPDATE_RADIUS, start.y - LIGHT_UPDATE_RADIUS },
+            (Vector2i) { end.x + LIGHT_UPDATE_RADIUS, end.y + LIGHT_UPDATE_RADIUS }
+        );
+    }
+    else chunk_manager_update_lighting_area(start, end);
+    chunk->state = CHUNK_STATE_LIT;
+}
+
+static void finish_loading_chunk(Chunk* chunk, ChunkLoadStatus status) {
+    if (status == CHUNK_LOAD_SUCCESS) {
+        chunk->uniform = chunk_codec_is_uniform(chunk->layers, NULL);
+        chunk_update_tick_list(chunk);
+        chunk->state = CHUNK_STATE_LOADED;
+    }
+    else {
+        // The chunk is left out of the game, so it doesn't get saved over whatever is on the disk
+        chunk_free_meshes(chunk);
+    }
+}
 
-    int cw = chunk_view_width;
-    int ch = chunk_view_height;
-    size_t count = chunk_count;
+// Runs on a worker thread
+static void load_job_work(void* data) {
+    ChunkLoadJob* job = data;
+    job->status = load_chunk_or_generate(&job->chunk, job->demo);
+}
 
-    int min_x = newCenter.x - (cw / 2);
-    int min_y = newCenter.y - (ch / 2);
-    int max_x = min_x + cw - 1;
-    int max_y = min_y + ch - 1;
+// Runs on the main thread when polling the pool
+static void load_job_done(void* data) {
+    ChunkLoadJob* job = data;
 
-    Chunk* new_chunks = (Chunk*)malloc(sizeof(Chunk) * count);
-    if (!new_chunks) {
-        TraceLog(LOG_ERROR, "Failed to allocate memory for relocating Chunks.\n");
-        return;
+    // The chunk might have left the view while it was being loaded
+    Chunk* chunk = discard_load_jobs ? NULL : chunk_manager_get_chunk(job->chunk.position);
+    if (chunk && chunk->initialized && chunk->state == CHUNK_STATE_REQUESTED && chunk->loadRequest == job->request) {
+        if (job->status == CHUNK_LOAD_SUCCESS) {
+            for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+                chunk_layer_move_blocks(&chunk->layers[l], &job->chunk.layers[l]);
+            }
+        }
+        finish_loading_chunk(chunk, job->status);
+        if (chunk->initialized) light_loaded_chunk(chunk);
     }
-    for (size_t i = 0; i < count; i++) {
-        memset(&new_chunks[i], 0, sizeof(Chunk));
-        new_chunks[i].initialized = false;
+    else if (job->status == CHUNK_LOAD_SUCCESS) {
+        chunk_free_block_data(&job->chunk);
     }
 
-    bool* occupied = (bool*)malloc(sizeof(bool) * count);
-    if (!occupied) {
-        free(new_chunks);
-        TraceLog(LOG_ERROR, "Failed to allocate memory for relocate helper.\n");
+    free(job);
+}
+
+// Sets up a chunk that just entered the view. Unless it is on the cache, it stays empty
+// until a worker finishes loading it, and chunk_manager_update_loading picks it up.
+static void request_chunk(Chunk* chunk, Vector2i position) {
+    memset(chunk, 0, sizeof(Chunk));
+    chunk_init(chunk, position);
+    if (!chunk->initialized) return;
+    chunk->state = CHUNK_STATE_REQUESTED;
+    chunk->loadRequest = ++load_request_counter;
+
+    bool demo = game_is_demo_mode();
+    if (!demo && load_chunk_from_cache(chunk)) {
+        finish_loading_chunk(chunk, CHUNK_LOAD_SUCCESS);
+        return;
+    }
+
+    ChunkLoadStatus status;
+    if (!demo && load_chunk_from_pending_save(chunk, &status)) {
+        finish_loading_chunk(chunk, status);
         return;
     }
-    for (size_t i = 0; i < count; i++) occupied[i] = false;
 
-    for (size_t i = 0; i < count; i++) {
-        Chunk* old = &chunks[i];
-        if (!old->initialized) continue;
+    if (load_pool) {
+        ChunkLoadJob* job = calloc(1, sizeof(ChunkLoadJob));
+        if (job) {
+            job->chunk.position = position;
+            job->request = chunk->loadRequest;
+            job->demo = demo;
+            if (worker_pool_submit(load_pool, load_job_work, load_job_done, job)) return;
+            free(job);
+        }
+        else {
+            TraceLog(LOG_ERROR, "Could not allocate memory for a chunk load job.");
+        }
+    }
 
-        int px = old->position.x;
-        int py = old->position.y;
+    // Without workers the chunk is loaded right here
+    finish_loading_chunk(chunk, load_chunk_or_generate(chunk, demo));
+}
 
-        if (px >= min_x && px <= max_x && py >= min_y && py <= max_y) {
-            int nx = px - min_x;
-            int ny = py - min_y;
-            size_t new_index = (size_t)(ny * cw + nx);
+// Waits for the load jobs that are still running. If apply is false, their results are thrown away.
+static void finish_load_jobs(bool apply) {
+    if (!load_pool) return;
 
-            memcpy(&new_chunks[new_index], old, sizeof(Chunk));
-            occupied[new_index] = true;
+    discard_load_jobs = !apply;
+    worker_pool_wait(load_pool);
+    worker_pool_poll(load_pool, 0);
+    discard_load_jobs = false;
+}
+
+// Light that came in from the chunks that just left the view would otherwise stay around,
+// so the cells along the borders they shared with the chunks that stayed are relit.
+// The old view is given in chunk coordinates (inclusive).
+static void relight_dropped_borders(Vector2i old_min, Vector2i old_max) {
+    Vector2i new_min = { currentChunkPos.x - (chunk_view_width / 2), currentChunkPos.y - (chunk_view_height / 2) };
+    Vector2i new_max = { new_min.x + chunk_view_width - 1, new_min.y + chunk_view_height - 1 };
+    const Vector2i dirs[4] = { { 0, -1 }, { 1, 0 }, { 0, 1 }, { -1, 0 } };
 
-            old->initialized = false;
+    for (size_t c = 0; c < chunk_count; c++) {
+        Chunk* chunk = chunks[c];
+        if (!chunk->initialized || chunk->state < CHUNK_STATE_LIT) continue;
+
+        Vector2i start = { chunk->position.x * CHUNK_WIDTH, chunk->position.y * CHUNK_WIDTH };
+        Vector2i end = { start.x + CHUNK_WIDTH - 1, start.y + CHUNK_WIDTH - 1 };
+
+        for (int d = 0; d < 4; d++) {
+            Vector2i n = { chunk->position.x + dirs[d].x, chunk->position.y + dirs[d].y };
+            bool inNewView = n.x >= new_min.x && n.x <= new_max.x && n.y >= new_min.y && n.y <= new_max.y;
+            bool inOldView = n.x >= old_min.x && n.x <= old_max.x && n.y >= old_min.y && n.y <= old_max.y;
+            if (inNewView || !inOldView) continue;
+
+            switch (d) {
+                case 0: chunk_manager_mark_dirty_area(start, (Vector2i) { end.x, start.y }); break;
+                case 1: chunk_manager_mark_dirty_area((Vector2i) { end.x, start.y }, end); break;
+                case 2: chunk_manager_mark_dirty_area((Vector2i) { start.x, end.y }, end); break;
+                case 3: chunk_manager_mark_dirty_area(start, (Vector2i) { start.x, end.y }); break;
+            }
         }
     }
 
-    for (size_t i = 0; i < count; i++) {
-        move_chunk_to_cache(&chunks[i]);
+    chunk_manager_flush_changes();
+}
+
+// Lights the chunks that were loaded while relocating. It must happen after the neighbors are set up.
+static void light_loaded_chunks() {
+    for (size_t c = 0; c < chunk_count; c++) {
+        if (chunks[c]->initialized && chunks[c]->state == CHUNK_STATE_LOADED) light_loaded_chunk(chunks[c]);
     }
+}
+
+void chunk_manager_update_loading() {
+    if (!initialized) return;
+    worker_pool_poll(load_pool, 0);
+    worker_pool_poll(save_pool, 0);
+    commit_finished_saves();
+}
 
-    for (size_t i = 0; i < count; i++) {
-        if (!occupied[i]) {
-            int x = i % cw;
-            int y = i / cw;
-            int chunk_x = min_x + x;
-            int chunk_y = min_y + y;
+void chunk_manager_finish_loading() {
+    if (!initialized) return;
+    finish_load_jobs(true);
+}
 
-            memset(&new_chunks[i], 0, sizeof(Chunk));
-            chunk_init(&new_chunks[i], (Vector2i) { chunk_x, chunk_y });
-            if (game_is_demo_mode()) {
-                chunk_regenerate(&new_chunks[i]);
-            } else {
-                load_chunk_or_generate(&new_chunks[i]);
-            }
-			chunk_update_tick_list(&new_chunks[i]);
-            occupied[i] = true;
+int chunk_manager_get_loading_count() {
+    if (!initialized) return 0;
+
+    int count = 0;
+    for (size_t c = 0; c < chunk_count; c++) {
+        if (chunks[c]->initialized && chunks[c]->state == CHUNK_STATE_REQUESTED) count++;
+    }
+    return count;
+}
+
+// Loaded chunks with changes that weren't saved yet, plus the cache entries that weren't saved.
+static int get_unsaved_count() {
+    int count = cache_dirty_count;
+    for (size_t c = 0; c < chunk_count; c++) {
+        if (chunks[c]->initialized && chunks[c]->state != CHUNK_STATE_REQUESTED && chunks[c]->modified) count++;
+    }
+    return count;
+}
+
+bool chunk_manager_update_autosave() {
+    if (!initialized || game_is_demo_mode()) return false;
+
+    update_block_ui();
+
+    GameSettings* settings = get_game_settings();
+    double now = GetTime();
+    bool started = false;
+
+    if (!autosave_running) {
+        int unsaved = get_unsaved_count();
+        if (unsaved == 0) {
+            last_autosave_time = now;
+            return false;
         }
+
+        bool intervalDue = settings->autosave_interval > 0 && now - last_autosave_time >= settings->autosave_interval;
+        bool countDue = settings->autosave_chunks > 0 && unsaved >= settings->autosave_chunks;
+        if (!intervalDue && !countDue) return false;
+
+        // The loaded chunks are all taken at once, so what ends up on the disk is the view from a single frame
+        for (size_t c = 0; c < chunk_count; c++) {
+            Chunk* chunk = chunks[c];
+            if (!chunk->initialized || chunk->state == CHUNK_STATE_REQUESTED || !chunk->modified) continue;
+            if (queue_chunk_save(chunk->position, chunk->layers)) chunk->modified = false;
+        }
+
+        last_autosave_time = now;
+        autosave_running = true;
+        started = true;
     }
 
-    free(chunks);
-    free(occupied);
+    // The cache entries don't change anymore, so they can be taken in small batches without a hitch
+    ChunkCacheEntry *cacheEntry, *tmp;
+    HASH_ITER(hh, chunkCache, cacheEntry, tmp) {
+        if (!cacheEntry->dirty) continue;
+        save_cache_entry(cacheEntry);
+        if (GetTime() - now > AUTOSAVE_FRAME_BUDGET) return started;
+    }
 
-    chunks = new_chunks;
-    currentChunkPos = newCenter;
+    autosave_running = false;
+    queue_pending_world_info();
+    return started;
+}
 
-    for (int y = 0; y < ch; y++) {
-        for (int x = 0; x < cw; x++) {
-            size_t idx = y * cw + x;
-            Chunk* c = &chunks[idx];
+int chunk_manager_get_saving_count() {
+    if (!initialized || !save_pool) return 0;
+    return worker_pool_get_pending_count(save_pool);
+}
 
-            c->neighbors.up = (y > 0) ? &chunks[(y - 1) * cw + x] : NULL;
-            c->neighbors.right = (x < cw - 1) ? &chunks[y * cw + (x + 1)] : NULL;
-            c->neighbors.down = (y < ch - 1) ? &chunks[(y + 1) * cw + x] : NULL;
-            c->neighbors.left = (x > 0) ? &chunks[y * cw + (x - 1)] : NULL;
+// Like %, but always positive
+static int wrap(int value, int m) {
+    return ((value % m) + m) % m;
+}
 
-            c->neighbors.upLeft = (x > 0 && y > 0) ? &chunks[(y - 1) * cw + (x - 1)] : NULL;
-            c->neighbors.upRight = (x < cw - 1 && y > 0) ? &chunks[(y - 1) * cw + (x + 1)] : NULL;
-            c->neighbors.downLeft = (x > 0 && y < ch - 1) ? &chunks[(y + 1) * cw + (x - 1)] : NULL;
-            c->neighbors.downRight = (x < cw - 1 && y < ch - 1) ? &chunks[(y + 1) * cw + (x + 1)] : NULL;
+// The view is a toroidal ring: a chunk always lives in the slot given by its position modulo the view size.
+// Moving the view only replaces the chunks that left it, in place, and the others never move in memory.
+static size_t chunk_slot(Vector2i position) {
+    return (size_t)(wrap(position.y, chunk_view_height) * chunk_view_width + wrap(position.x, chunk_view_width));
+}
+
+static bool is_in_view(Vector2i position) {
+    int min_x = currentChunkPos.x - (chunk_view_width / 2);
+    int min_y = currentChunkPos.y - (chunk_view_height / 2);
+
+    return position.x >= min_x && position.x < min_x + chunk_view_width && position.y >= min_y && position.y < min_y + chunk_view_height;
+}
+
+static void link_chunk_neighbors() {
+    for (size_t c = 0; c < chunk_count; c++) {
+        Chunk* chunk = chunks[c];
+        int x = chunk->position.x;
+        int y = chunk->position.y;
+
+        chunk->neighbors.up = chunk_manager_get_chunk((Vector2i) { x, y - 1 });
+        chunk->neighbors.right = chunk_manager_get_chunk((Vector2i) { x + 1, y });
+        chunk->neighbors.down = chunk_manager_get_chunk((Vector2i) { x, y + 1 });
+        chunk->neighbors.left = chunk_manager_get_chunk((Vector2i) { x - 1, y });
+
+        chunk->neighbors.upLeft = chunk_manager_get_chunk((Vector2i) { x - 1, y - 1 });
+        chunk->neighbors.upRight = chunk_manager_get_chunk((Vector2i) { x + 1, y - 1 });
+        chunk->neighbors.downLeft = chunk_manager_get_chunk((Vector2i) { x - 1, y + 1 });
+        chunk->neighbors.downRight = chunk_manager_get_chunk((Vector2i) { x + 1, y + 1 });
+    }
+}
+
+// Requests every chunk in the view that isn't on its slot yet, sending whatever was there to the cache.
+// Returns true if any slot changed.
+static bool fill_view() {
+    int min_x = currentChunkPos.x - (chunk_view_width / 2);
+    int min_y = currentChunkPos.y - (chunk_view_height / 2);
+    bool changed = false;
+
+    for (int y = min_y; y < min_y + chunk_view_height; y++) {
+        for (int x = min_x; x < min_x + chunk_view_width; x++) {
+            Chunk* chunk = chunks[chunk_slot((Vector2i) { x, y })];
+            if (chunk->initialized && chunk->position.x == x && chunk->position.y == y) continue;
+
+            move_chunk_to_cache(chunk);
+            request_chunk(chunk, (Vector2i) { x, y });
+            changed = true;
         }
     }
 
-    chunk_manager_update_lighting();
+    return changed;
+}
+
+// The old view is given in chunk coordinates (inclusive).
+static void finish_view_change(Vector2i old_min, Vector2i old_max) {
+    // The edges of the view changed, so the neighbors are linked again. It's just pointers, nothing is copied.
+    link_chunk_neighbors();
+
+    // The chunks that stayed keep their light, so only the new ones and the borders need to be lit
+    relight_dropped_borders(old_min, old_max);
+    light_loaded_chunks();
+}
+
+typedef struct {
+    Vector2i min;
+    Vector2i max;
+} PrefetchJob;
+
+// Runs on a worker thread, since it has to wait for the region lock, which the save thread can hold through a sync
+static void prefetch_job_work(void* data) {
+    PrefetchJob* job = data;
+    Vector2i min = job->min;
+    Vector2i max = job->max;
+
+    world_manager_prefetch_chunks(min, (Vector2i) { max.x, min.y });
+    world_manager_prefetch_chunks((Vector2i) { min.x, max.y }, max);
+    world_manager_prefetch_chunks((Vector2i) { min.x, min.y + 1 }, (Vector2i) { min.x, max.y - 1 });
+    world_manager_prefetch_chunks((Vector2i) { max.x, min.y + 1 }, (Vector2i) { max.x, max.y - 1 });
+    free(job);
+}
+
+// The chunks right outside the view are the next ones to come in, so the disk can start reading them.
+// It's only a hint, so it's skipped when there are no loading threads.
+static void prefetch_view_ring() {
+    if (game_is_demo_mode() || !load_pool) return;
+
+    PrefetchJob* job = malloc(sizeof(PrefetchJob));
+    if (!job) return;
+    job->min = (Vector2i) { currentChunkPos.x - (chunk_view_width / 2) - 1, currentChunkPos.y - (chunk_view_height / 2) - 1 };
+    job->max = (Vector2i) { job->min.x + chunk_view_width + 1, job->min.y + chunk_view_height + 1 };
+
+    if (!worker_pool_submit(load_pool, prefetch_job_work, NULL, job)) free(job);
+}
+
+void chunk_manager_relocate(Vector2i newCenter) {
+    if (!initialized) return;
+
+    Vector2i old_min = { currentChunkPos.x - (chunk_view_width / 2), currentChunkPos.y - (chunk_view_height / 2) };
+    Vector2i old_max = { old_min.x + chunk_view_width - 1, old_min.y + chunk_view_height - 1 };
+
+    currentChunkPos = newCenter;
+    if (fill_view()) {
+        finish_view_change(old_min, old_max);
+        prefetch_view_ring();
+    }
 }
 
 void chunk_manager_set_view(uint8_t new_view_width, uint8_t new_view_height) {
     if (!initialized) return;
     if (new_view_width == chunk_view_width && new_view_height == chunk_view_height) return;
 
-    size_t old_count = chunk_count;
-
-    int new_cw = new_view_width;
-    int new_ch = new_view_height;
-    size_t new_count = (size_t)new_cw * (size_t)new_ch;
+    Vector2i old_min = { currentChunkPos.x - (chunk_view_width / 2), currentChunkPos.y - (chunk_view_height / 2) };
+    Vector2i old_max = { old_min.x + chunk_view_width - 1, old_min.y + chunk_view_height - 1 };
 
-    int new_min_x = currentChunkPos.x - (new_cw / 2);
-    int new_min_y = currentChunkPos.y - (new_ch / 2);
-    int new_max_x = new_min_x + new_cw - 1;
-    int new_max_y = new_min_y + new_ch - 1;
+    size_t new_count = (size_t)new_view_width * (size_t)new_view_height;
+    size_t old_count = chunk_count;
 
-    Chunk* new_chunks = (Chunk*)malloc(sizeof(Chunk) * new_count);
-    if (!new_chunks) {
+    // The slots depend on the size of the view, so this is the only case where the chunks change slots.
+    // Only the pointers are moved, and the chunks that leave the view are reused for the new slots.
+    // Everything is allocated before changing anything, so running out of memory leaves the view as it was.
+    Chunk** new_chunks = (Chunk**)calloc(new_count, sizeof(Chunk*));
+    size_t spare_count = new_count > old_count ? new_count - old_count : 0;
+    Chunk** spare = (Chunk**)calloc(spare_count + old_count, sizeof(Chunk*));
+    if (!new_chunks || !spare) {
         TraceLog(LOG_ERROR, "Failed to allocate memory for new chunk view.\n");
+        free(new_chunks);
+        free(spare);
         return;
     }
-    for (size_t i = 0; i < new_count; i++) {
-        memset(&new_chunks[i], 0, sizeof(Chunk));
-        new_chunks[i].initialized = false;
+    for (size_t i = 0; i < spare_count; i++) {
+        spare[i] = (Chunk*)calloc(1, sizeof(Chunk));
+        if (!spare[i]) {
+            TraceLog(LOG_ERROR, "Failed to allocate memory for new chunk view.\n");
+            free_chunks(spare, i);
+            free(new_chunks);
+            return;
+        }
     }
 
-    bool* occupied = (bool*)malloc(sizeof(bool) * new_count);
-    if (!occupied) {
-        free(new_chunks);
-        TraceLog(LOG_ERROR, "Failed to allocate helper memory.\n");
-        return;
-    }
-    for (size_t i = 0; i < new_count; i++) occupied[i] = false;
+    Chunk** old_chunks = chunks;
+
+    chunks = new_chunks;
+    chunk_view_width = new_view_width;
+    chunk_view_height = new_view_height;
+    chunk_count = new_count;
 
     for (size_t i = 0; i < old_count; i++) {
-        Chunk* old = &chunks[i];
-        if (!old->initialized) continue;
+        Chunk* old = old_chunks[i];
+
+        if (old->initialized && is_in_view(old->position)) {
+            chunks[chunk_slot(old->position)] = old;
+            continue;
+        }
 
-        int px = old->position.x;
-        int py = old->position.y;
+        move_chunk_to_cache(old);
+        spare[spare_count++] = old;
+    }
 
-        if (px >= new_min_x && px <= new_max_x && py >= new_min_y && py <= new_max_y) {
-            int nx = px - new_min_x;
-            int ny = py - new_min_y;
-            size_t new_index = (size_t)(ny * new_cw + nx);
+    // The empty slots take the chunks that left, and the ones left over are freed
+    for (size_t c = 0; c < chunk_count; c++) {
+        if (chunks[c]) continue;
+        chunks[c] = spare[--spare_count];
+        chunks[c]->initialized = false;
+    }
+    free_chunks(spare, spare_count);
+    free(old_chunks);
 
-            memcpy(&new_chunks[new_index], old, sizeof(Chunk));
-            occupied[new_index] = true;
+    fill_view();
+    finish_view_change(old_min, old_max);
+}
+
+void chunk_manager_update_lighting() {
+    if (!initialized) return;
 
-            old->initialized = false;
+    // Everything is going to be relit, so the pending changes don't matter anymore
+    dirty_cell_count = 0;
+
+    for (size_t c = 0; c < chunk_count; c++) {
+        for (int i = 0; i < CHUNK_AREA; i++) chunks[c]->light[i] = 0;
+    }
+
+    // Seed every light source first and spread them all in a single pass
+    for (size_t c = 0; c < chunk_count; c++) {
+        if (chunks[c]->uniform) {
+            chunk_queue_uniform_light(chunks[c]);
+            continue;
+        }
+
+        for (int i = 0; i < CHUNK_AREA; i++) {
+            Vector2u pos = { i % CHUNK_WIDTH, i / CHUNK_WIDTH };
+            chunk_queue_light(chunks[c], pos, chunk_get_light_source(chunks[c], pos));
         }
     }
 
-    for (size_t i = 0; i < old_count; i++) {
-        move_chunk_to_cache(&chunks[i]);
+    chunk_propagate_light();
+
+    chunk_manager_remesh();
+}
+
+void chunk_manager_remesh() {
+    if (!initialized) return;
+    for (size_t c = 0; c < chunk_count; c++) chunks[c]->meshDirty = true;
+}
+
+static bool is_mesh_job_running(Vector2i position) {
+    for (int i = 0; i < mesh_job_count; i++) {
+        if (mesh_job_positions[i].x == position.x && mesh_job_positions[i].y == position.y) return true;
     }
+    return false;
+}
 
-    for (size_t i = 0; i < new_count; i++) {
-        if (!occupied[i]) {
-            int x = i % new_cw;
-            int y = i / new_cw;
-            int chunk_x = new_min_x + x;
-            int chunk_y = new_min_y + y;
+static Chunk* find_nearest_dirty_chunk(Vector2 center) {
+    Chunk* nearest = NULL;
+    float nearestDistance = FLT_MAX;
 
-            memset(&new_chunks[i], 0, sizeof(Chunk));
-            chunk_init(&new_chunks[i], (Vector2i) { chunk_x, chunk_y });
-            if (game_is_demo_mode()) {
-                chunk_regenerate(&new_chunks[i]);
-            } else {
-                load_chunk_or_generate(&new_chunks[i]);
-            }
-			chunk_update_tick_list(&new_chunks[i]);
-            occupied[i] = true;
+    for (size_t c = 0; c < chunk_count; c++) {
+        if (!chunks[c]->initialized || !chunks[c]->meshDirty) continue;
+        // Chunks are only meshed after they are loaded and lit
+        if (chunks[c]->state < CHUNK_STATE_LIT) continue;
+        if (is_mesh_job_running(chunks[c]->position)) continue;
+
+        Vector2 chunkCenter = {
+            (chunks[c]->position.x * CHUNK_WIDTH + CHUNK_WIDTH / 2.0f) * TILE_SIZE,
+            (chunks[c]->position.y * CHUNK_WIDTH + CHUNK_WIDTH / 2.0f) * TILE_SIZE
+        };
+        float distance = Vector2DistanceSqr(center, chunkCenter);
+        if (distance < nearestDistance) {
+            nearestDistance = distance;
+            nearest = chunks[c];
         }
     }
 
-    free(chunks);
-    free(occupied);
+    return nearest;
+}
+
+static void copy_chunk_for_meshing(Chunk* dst, Chunk* src) {
+    dst->position = src->position;
+    dst->initialized = true;
+    dst->state = src->state;
+    dst->uniform = src->uniform;
+    memcpy(dst->light, src->light, sizeof(src->light));
+    // Meshing doesn't look at the block data, so only the ids and states are copied
+    for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+        memcpy(dst->layers[l].ids, src->layers[l].ids, sizeof(src->layers[l].ids));
+        memcpy(dst->layers[l].states, src->layers[l].states, sizeof(src->layers[l].states));
+    }
+}
 
-    chunks = new_chunks;
-    chunk_view_width = new_view_width;
-    chunk_view_height = new_view_height;
-    chunk_count = new_count;
+// Runs on a worker thread, so it can only touch the snapshot inside the job
+static void mesh_job_work(void* data) {
+    ChunkMeshJob* job = data;
+    job->built = chunk_build_mesh_data(&job->snapshot[4], &job->previous, &job->data);
+}
 
-    for (int y = 0; y < new_ch; y++) {
-        for (int x = 0; x < new_cw; x++) {
-            size_t idx = y * new_cw + x;
-            Chunk* c = &chunks[idx];
+// Runs on the main thread when polling the pool
+static void mesh_job_done(void* data) {
+    ChunkMeshJob* job = data;
+    Vector2i position = job->snapshot[4].position;
 
-            c->neighbors.up = (y > 0) ? &chunks[(y - 1) * new_cw + x] : NULL;
-            c->neighbors.right = (x < new_cw - 1) ? &chunks[y * new_cw + (x + 1)] : NULL;
-            c->neighbors.down = (y < new_ch - 1) ? &chunks[(y + 1) * new_cw + x] : NULL;
-            c->neighbors.left = (x > 0) ? &chunks[y * new_cw + (x - 1)] : NULL;
+    for (int i = 0; i < mesh_job_count; i++) {
+        if (mesh_job_positions[i].x == position.x && mesh_job_positions[i].y == position.y) {
+            mesh_job_positions[i] = mesh_job_positions[--mesh_job_count];
+            break;
+        }
+    }
 
-            c->neighbors.upLeft = (x > 0 && y > 0) ? &chunks[(y - 1) * new_cw + (x - 1)] : NULL;
-            c->neighbors.upRight = (x < new_cw - 1 && y > 0) ? &chunks[(y - 1) * new_cw + (x + 1)] : NULL;
-            c->neighbors.downLeft = (x > 0 && y < new_ch - 1) ? &chunks[(y + 1) * new_cw + (x - 1)] : NULL;
-            c->neighbors.downRight = (x < new_cw - 1 && y < new_ch - 1) ? &chunks[(y + 1) * new_cw + (x + 1)] : NULL;
+    if (job->built) {
+        // The chunk might have been unloaded while the mesh was being built
+        Chunk* chunk = discard_mesh_jobs ? NULL : chunk_manager_get_chunk(position);
+        if (chunk && chunk->initialized) {
+            chunk_apply_mesh_data(chunk, &job->data);
+        }
+        else {
+            for (int l = 0; l < CHUNK_LAYER_COUNT; l++) chunk_layer_free_mesh_data(&job->data.layers[l]);
         }
     }
 
-    chunk_manager_update_lighting();
+    free(job);
 }
 
-void chunk_manager_update_lighting() {
+static bool submit_mesh_job(Chunk* chunk) {
+    ChunkMeshJob* job = calloc(1, sizeof(ChunkMeshJob));
+    if (!job) {
+        TraceLog(LOG_ERROR, "Could not allocate memory for a chunk mesh job.");
+        return false;
+    }
+
+    // The workers only see copies of the chunk and its neighbors, so the game can keep changing them
+    Chunk* neighbors[9] = {
+        chunk->neighbors.upLeft, chunk->neighbors.up, chunk->neighbors.upRight,
+        chunk->neighbors.left, chunk, chunk->neighbors.right,
+        chunk->neighbors.downLeft, chunk->neighbors.down, chunk->neighbors.downRight
+    };
+    for (int i = 0; i < 9; i++) {
+        if (neighbors[i]) copy_chunk_for_meshing(&job->snapshot[i], neighbors[i]);
+    }
+    if (chunk->render) job->previous = chunk->render->meshInputs;
+
+    Chunk* center = &job->snapshot[4];
+    center->neighbors = (ChunkNeighbors) {
+        .upLeft = neighbors[0] ? &job->snapshot[0] : NULL,
+        .up = neighbors[1] ? &job->snapshot[1] : NULL,
+        .upRight = neighbors[2] ? &job->snapshot[2] : NULL,
+        .left = neighbors[3] ? &job->snapshot[3] : NULL,
+        .right = neighbors[5] ? &job->snapshot[5] : NULL,
+        .downLeft = neighbors[6] ? &job->snapshot[6] : NULL,
+        .down = neighbors[7] ? &job->snapshot[7] : NULL,
+        .downRight = neighbors[8] ? &job->snapshot[8] : NULL
+    };
+
+    if (!worker_pool_submit(mesh_pool, mesh_job_work, mesh_job_done, job)) {
+        free(job);
+        return false;
+    }
+
+    mesh_job_positions[mesh_job_count++] = chunk->position;
+    chunk->meshDirty = false;
+    return true;
+}
+
+// Waits for the mesh jobs that are still running. If apply is false, their results are thrown away.
+static void finish_mesh_jobs(bool apply) {
+    if (!mesh_pool) return;
+
+    discard_mesh_jobs = !apply;
+    worker_pool_wait(mesh_pool);
+    worker_pool_poll(mesh_pool, 0);
+    discard_mesh_jobs = false;
+}
+
+void chunk_manager_update_meshes(Vector2 center, double time_budget) {
     if (!initialized) return;
 
+    double start = GetTime();
+
+    // Without workers, every iteration builds the dirty chunk closest to the center.
+    // Building clears the flag, so no chunk gets built twice in the same call.
+    if (!mesh_pool) {
+        for (size_t n = 0; n < chunk_count; n++) {
+            Chunk* nearest = find_nearest_dirty_chunk(center);
+            if (!nearest) break;
+
+            chunk_genmesh(nearest);
+
+            if (time_budget > 0.0 && GetTime() - start >= time_budget) break;
+        }
+        return;
+    }
+
+    int maxJobs = worker_pool_get_thread_count(mesh_pool) * MESH_JOBS_PER_THREAD;
+    if (maxJobs > MAX_MESH_JOBS) maxJobs = MAX_MESH_JOBS;
+
+    while (true) {
+        // Upload what the workers finished, which is the only part that must happen on the main thread
+        while (time_budget <= 0.0 || GetTime() - start < time_budget) {
+            if (worker_pool_poll(mesh_pool, 1) == 0) break;
+        }
+
+        // Keep the workers busy with the chunks closest to the center.
+        // A chunk that already has a job running waits for it to finish, so the results never arrive out of order.
+        while (mesh_job_count < maxJobs) {
+            Chunk* nearest = find_nearest_dirty_chunk(center);
+            if (!nearest || !submit_mesh_job(nearest)) break;
+        }
+
+        // With no budget, everything has to be done before returning
+        if (time_budget > 0.0 || mesh_job_count == 0) break;
+        worker_pool_wait(mesh_pool);
+    }
+}
+
+void chunk_manager_benchmark_meshing(int iterations) {
+    if (!initialized || iterations <= 0) return;
+
+    // The sum is only there so the compiler doesn't throw the loops away
+    volatile int sum = 0;
+
+    // Resolving the variant of every loaded block through the generator functions, like the meshing used to do
+    double start = GetTime();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t c = 0; c < chunk_count; c++) {
+            for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+                ChunkLayer* layer = &chunks[c]->layers[l];
+                for (int i = 0; i < CHUNK_AREA; i++) {
+                    BlockVariant bvar = br_get_block_registry(layer->ids[i])->variant_generator(layer->states[i]);
+                    sum += block_models_get_vertex_count(bvar.model_idx);
+                }
+            }
+        }
+    }
+    double generatorTime = GetTime() - start;
+
+    // The same thing but with the baked variant table
+    start = GetTime();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t c = 0; c < chunk_count; c++) {
+            for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+                ChunkLayer* layer = &chunks[c]->layers[l];
+                for (int i = 0; i < CHUNK_AREA; i++) {
+                    sum += br_get_block_variant(layer->ids[i], layer->states[i])->vertex_count;
+                }
+            }
+        }
+    }
+    double tableTime = GetTime() - start;
+
+    start = GetTime();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t c = 0; c < chunk_count; c++) {
+            // Nothing changed between the iterations, so the chunks are made to build every cell
+            if (chunks[c]->render) chunks[c]->render->meshInputs.valid = false;
+            chunk_genmesh(chunks[c]);
+        }
+    }
+    double meshTime = GetTime() - start;
+
+    TraceLog(LOG_INFO, "Meshing benchmark (%d iterations, %zu chunks):", iterations, chunk_count);
+    TraceLog(LOG_INFO, "    Variant generators: %.3f ms", generatorTime * 1000.0);
+    TraceLog(LOG_INFO, "    Variant table: %.3f ms (%.1fx faster)", tableTime * 1000.0, tableTime > 0.0 ? generatorTime / tableTime : 0.0);
+    TraceLog(LOG_INFO, "    chunk_genmesh: %.3f ms per chunk", (meshTime * 1000.0) / (iterations * chunk_count));
+}
+
+void chunk_manager_benchmark_storage() {
+    if (!initialized) return;
+
+    // Only the blocks are copied, the block data stays owned by the chunks
+    ChunkLayer (*layers)[CHUNK_LAYER_COUNT] = malloc(sizeof(*layers) * chunk_count);
+    if (!layers) return;
+
+    int count = 0;
     for (size_t c = 0; c < chunk_count; c++) {
-        for (int i = 0; i < CHUNK_AREA; i++) chunks[c].light[i] = 0;
+        if (chunks[c]->state == CHUNK_STATE_REQUESTED) continue;
+        memcpy(layers[count++], chunks[c]->layers, sizeof(*layers));
     }
 
+    world_manager_benchmark_storage(layers, count);
+    free(layers);
+}
+
+int chunk_manager_get_dirty_mesh_count() {
+    if (!initialized) return 0;
+
+    int count = mesh_job_count;
     for (size_t c = 0; c < chunk_count; c++) {
-        for (int i = 0; i < CHUNK_AREA; i++) {
-            BlockInstance b = chunks[c].layers[CHUNK_LAYER_FOREGROUND].blocks[i];
-            BlockInstance w = chunks[c].layers[CHUNK_LAYER_BACKGROUND].blocks[i];
+        if (chunks[c]->meshDirty && chunks[c]->state >= CHUNK_STATE_LIT) count++;
+    }
+    return count;
+}
+
+static Vector2i block_to_chunk_pos(Vector2i position) {
+    return (Vector2i) {
+        (int)floorf((float)position.x / (float)CHUNK_WIDTH),
+        (int)floorf((float)position.y / (float)CHUNK_WIDTH)
+    };
+}
 
-            BlockRegistry* bbr = br_get_block_registry(b.id);
-            BlockRegistry* wbr = br_get_block_registry(w.id);
+static void mark_mesh_dirty_area(Vector2i start, Vector2i end) {
+    Vector2i startChunk = block_to_chunk_pos(start);
+    Vector2i endChunk = block_to_chunk_pos(end);
+
+    for (int cy = startChunk.y; cy <= endChunk.y; cy++) {
+        for (int cx = startChunk.x; cx <= endChunk.x; cx++) {
+            Chunk* chunk = chunk_manager_get_chunk((Vector2i) { cx, cy });
+            if (chunk) chunk->meshDirty = true;
+        }
+    }
+}
 
-            int x = i % CHUNK_WIDTH;
-            int y = i / CHUNK_WIDTH;
+void chunk_manager_mark_dirty_area(Vector2i start, Vector2i end) {
+    if (!initialized) return;
 
-            if ((bbr->lightLevel == BLOCK_LIGHT_TRANSPARENT || !(bbr->flags & BLOCK_FLAG_FULL_BLOCK)) && (wbr->lightLevel == BLOCK_LIGHT_TRANSPARENT || !(wbr->flags & BLOCK_FLAG_FULL_BLOCK))) {
-                chunk_fill_light(&chunks[c], (Vector2u) { x, y }, 15);
-            }
-            else if (bbr->lightLevel > 0 || wbr->lightLevel > 0) {
-                uint8_t maxLight = fmax(bbr->lightLevel, wbr->lightLevel);
-                chunk_fill_light(&chunks[c], (Vector2u) { x, y }, maxLight);
+    for (int y = start.y; y <= end.y; y++) {
+        for (int x = start.x; x <= end.x; x++) {
+            if (dirty_cell_count >= dirty_cell_capacity) {
+                size_t new_capacity = dirty_cell_capacity > 0 ? dirty_cell_capacity * 2 : CHUNK_AREA;
+                Vector2i* new_cells = realloc(dirty_cells, sizeof(Vector2i) * new_capacity);
+                if (!new_cells) {
+                    TraceLog(LOG_ERROR, "Could not allocate memory for the dirty cell list.");
+                    return;
+                }
+                dirty_cells = new_cells;
+                dirty_cell_capacity = new_capacity;
             }
+
+            dirty_cells[dirty_cell_count++] = (Vector2i) { x, y };
         }
     }
+}
+
+void chunk_manager_flush_changes() {
+    if (!initialized) return;
+
+    for (size_t i = 0; i < dirty_cell_count; i++) {
+        Vector2i cell = dirty_cells[i];
+
+        Chunk* chunk = chunk_manager_get_chunk(block_to_chunk_pos(cell));
+        if (!chunk) continue;
+
+        Vector2u relPos = {
+            .x = ((cell.x % CHUNK_WIDTH) + CHUNK_WIDTH) % CHUNK_WIDTH,
+            .y = ((cell.y % CHUNK_WIDTH) + CHUNK_WIDTH) % CHUNK_WIDTH
+        };
+        chunk_queue_light_removal(chunk, relPos);
+
+        // Light can't travel further than the radius, so only the chunks in that range need a new mesh
+        mark_mesh_dirty_area(
+            (Vector2i) { cell.x - LIGHT_UPDATE_RADIUS, cell.y - LIGHT_UPDATE_RADIUS },
+            (Vector2i) { cell.x + LIGHT_UPDATE_RADIUS, cell.y + LIGHT_UPDATE_RADIUS }
+        );
+    }
+    dirty_cell_count = 0;
+
+    chunk_propagate_light();
+}
+
+void chunk_manager_remesh_area(Vector2i start, Vector2i end) {
+    if (!initialized) return;
+
+    mark_mesh_dirty_area(start, end);
+    if (!defer_changes) chunk_manager_flush_changes();
+}
+
+void chunk_manager_update_lighting_area(Vector2i start, Vector2i end) {
+    if (!initialized) return;
 
-    for (size_t c = 0; c < chunk_count; c++) chunk_genmesh(&chunks[c]);
+    chunk_manager_mark_dirty_area(start, end);
+    if (!defer_changes) chunk_manager_flush_changes();
 }
 
 void chunk_manager_draw(bool draw_lines) {
     if (!initialized) return;
 
     for (size_t i = 0; i < chunk_count; i++) {
-        chunk_draw(&chunks[i]);
+        chunk_draw(chunks[i]);
     }
 
     if (draw_lines) {
         for (size_t i = 0; i < chunk_count; i++) {
             rlPushMatrix();
             rlTranslatef(
-                chunks[i].position.x * CHUNK_WIDTH * TILE_SIZE,
-                chunks[i].position.y * CHUNK_WIDTH * TILE_SIZE,
+                chunks[i]->position.x * CHUNK_WIDTH * TILE_SIZE,
+                chunks[i]->position.y * CHUNK_WIDTH * TILE_SIZE,
                 0.0f
             );
 
@@ -371,16 +1422,20 @@ void chunk_manager_draw_liquids() {
     if (!initialized) return;
 
     for (size_t i = 0; i < chunk_count; i++) {
-        chunk_draw_liquids(&chunks[i]);
+        chunk_draw_liquids(chunks[i]);
     }
 }
 
 void chunk_manager_tick() {
     if (!initialized) return;
 
+    defer_changes = true;
     for (size_t i = 0; i < chunk_count; i++) {
-		chunk_tick(&chunks[i], tick_counter);
+		chunk_tick(chunks[i], tick_counter);
     }
+    defer_changes = false;
+
+    chunk_manager_flush_changes();
 
     tick_counter++;
 }
@@ -388,34 +1443,51 @@ void chunk_manager_tick() {
 void chunk_manager_clear(bool saveChunks) {
     if (!initialized) return;
 
+    // The chunks are going away, so whatever is being loaded or built for them is useless
+    finish_load_jobs(false);
+    finish_mesh_jobs(false);
+    update_block_ui();
+
+    double start = GetTime();
+    int saved = 0;
+    int unchanged = 0;
+
     for (size_t c = 0; c < chunk_count; c++) {
-        if (chunks[c].initialized) {
-            if (saveChunks) {
-                world_manager_save_chunk(
-                    chunks[c].position,
-                    chunks[c].layers
-                );
+        if (chunks[c]->initialized) {
+            // Chunks that didn't finish loading are empty, saving them would erase what is on the disk
+            if (saveChunks && chunks[c]->state != CHUNK_STATE_REQUESTED) {
+                if (chunks[c]->modified) {
+                    queue_chunk_save(
+                        chunks[c]->position,
+                        chunks[c]->layers
+                    );
+                    saved++;
+                }
+                else unchanged++;
             }
-            chunk_free_meshes(&chunks[c]);
-            chunk_free_block_data(&chunks[c]);
+            chunk_free_meshes(chunks[c]);
+            chunk_free_block_data(chunks[c]);
+            block_tick_list_free(&chunks[c]->blockTickList);
         }
 	}
 
     ChunkCacheEntry *cacheEntry, *tmp;
     HASH_ITER(hh, chunkCache, cacheEntry, tmp) {
-        if (saveChunks) {
-            world_manager_save_chunk(
-                cacheEntry->key,
-                cacheEntry->layers
-            );
+        if (saveChunks && cacheEntry->dirty) {
+            save_cache_entry(cacheEntry);
+            saved++;
         }
 
-        for (int i = 0; i < CHUNK_LAYER_COUNT; i++) {
-            chunk_layer_free_block_data(&cacheEntry->layers[i]);
-        }
+        remove_cache_entry(cacheEntry, true);
+    }
 
-        HASH_DEL(chunkCache, cacheEntry);
-        free(cacheEntry);
+    // The world might be unloaded right after this
+    queue_pending_world_info();
+    finish_save_jobs();
+    autosave_running = false;
+
+    if (saved > 0 || unchanged > 0) {
+        TraceLog(LOG_INFO, "Saved %d chunks in %.1f ms, %d were unchanged.", saved, (GetTime() - start) * 1000.0, unchanged);
     }
 }
 
@@ -424,6 +1496,26 @@ void chunk_manager_free() {
 
     chunk_manager_clear(!game_is_demo_mode());
 
+    worker_pool_destroy(save_pool);
+    save_pool = NULL;
+
+    finish_load_jobs(false);
+    worker_pool_destroy(load_pool);
+    load_pool = NULL;
+
+    finish_mesh_jobs(false);
+    worker_pool_destroy(mesh_pool);
+    mesh_pool = NULL;
+    chunk_free_light_queues();
+
+    if (dirty_cells) free(dirty_cells);
+    dirty_cells = NULL;
+    dirty_cell_count = 0;
+    dirty_cell_capacity = 0;
+
+    free_chunks(chunks, chunk_count);
+    chunks = NULL;
+
     initialized = false;
 }
 
@@ -441,6 +1533,17 @@ int chunk_manager_get_cached_chunk_count() {
     return HASH_COUNT(chunkCache);
 }
 
+ChunkCacheStats chunk_manager_get_cache_stats() {
+    return (ChunkCacheStats) {
+        .count = HASH_COUNT(chunkCache),
+        .bytes = cache_bytes,
+        .budget = (size_t)get_game_settings()->chunk_cache_mb * 1024 * 1024,
+        .hits = cache_hits,
+        .misses = cache_misses,
+        .evictions = cache_evictions
+    };
+}
+
 bool chunk_manager_interact(Vector2i position, ChunkLayerEnum layer, ItemSlot holdingItem) {
     if (!initialized) return false;
 
@@ -455,9 +1558,9 @@ bool chunk_manager_interact(Vector2i position, ChunkLayerEnum layer, ItemSlot ho
         .y = ((position.y % CHUNK_WIDTH) + CHUNK_WIDTH) % CHUNK_WIDTH
     };
 
-    BlockInstance* inst = chunk_get_block_ptr(chunk, relPos, layer);
-    if (!inst) return false;
-    BlockRegistry* brg = br_get_block_registry(inst->id);
+    BlockRef inst = chunk_get_block_ptr(chunk, relPos, layer);
+    if (!inst.id) return false;
+    BlockRegistry* brg = br_get_block_registry(*inst.id);
     if (!brg) return false;
 
 	// If the block has an interact callback, call it
@@ -473,7 +1576,10 @@ bool chunk_manager_interact(Vector2i position, ChunkLayerEnum layer, ItemSlot ho
             holdingItem
         );
         if (val) {
-            chunk_manager_update_lighting();
+            chunk->uniform = false;
+            chunk->modified = true;
+            watch_block_ui(chunk);
+            chunk_manager_update_lighting_area(position, position);
             return true;
         }
         else { return false; }
@@ -530,6 +1636,7 @@ void chunk_manager_set_block_safe(Vector2i position, BlockInstance blockValue, C
 
             if (canPlace) {
                 chunk_set_block(chunk, relPos, blockValue, layer, true);
+                watch_block_ui(chunk);
             }
         }
     }
@@ -544,38 +1651,17 @@ void chunk_manager_set_block_safe(Vector2i position, BlockInstance blockValue, C
 Chunk* chunk_manager_get_chunk(Vector2i position) {
     if (!initialized) return NULL;
 
-    Vector2i localChunkPos = {
-        position.x - (currentChunkPos.x - (chunk_view_width / 2)),
-        position.y - (currentChunkPos.y - (chunk_view_height / 2))
-    };
-
-    if (localChunkPos.x >= 0 && localChunkPos.x < chunk_view_width && localChunkPos.y >= 0 && localChunkPos.y < chunk_view_height) {
-        int chunkIndex = localChunkPos.y * chunk_view_width + localChunkPos.x;
-        return &chunks[chunkIndex];
-    }
-    else {
-        return NULL;
-    }
+    if (!is_in_view(position)) return NULL;
+    return chunks[chunk_slot(position)];
 }
 
 void chunk_manager_set_block(Vector2i position, BlockInstance blockValue, ChunkLayerEnum layer) {
     if (!initialized) return;
 
-    Vector2i chunkPos = {
-        (int)floorf((float)position.x / (float)CHUNK_WIDTH),
-        (int)floorf((float)position.y / (float)CHUNK_WIDTH)
-    };
-
-    Vector2i localChunkPos = {
-        chunkPos.x - (currentChunkPos.x - chunk_view_width / 2),
-        chunkPos.y - (currentChunkPos.y - chunk_view_height / 2)
-    };
-
-    if (localChunkPos.x >= 0 && localChunkPos.x < chunk_view_width && localChunkPos.y >= 0 && localChunkPos.y < chunk_view_height) {
-        int chunkIndex = localChunkPos.y * chunk_view_width + localChunkPos.x;
-
+    Chunk* chunk = chunk_manager_get_chunk(block_to_chunk_pos(position));
+    if (chunk) {
         chunk_set_block(
-            &chunks[chunkIndex],
+            chunk,
             (Vector2u){
                 .x = ((position.x % CHUNK_WIDTH) + CHUNK_WIDTH) % CHUNK_WIDTH,
                 .y = ((position.y % CHUNK_WIDTH) + CHUNK_WIDTH) % CHUNK_WIDTH
@@ -584,27 +1670,17 @@ void chunk_manager_set_block(Vector2i position, BlockInstance blockValue, ChunkL
             layer,
             true
         );
+        watch_block_ui(chunk);
     }
 }
 
 BlockInstance chunk_manager_get_block(Vector2i position, ChunkLayerEnum layer) {
 	if (!initialized) return (BlockInstance) { 0, 0, NULL };
 
-    Vector2i chunkPos = {
-        (int)floorf((float)position.x / (float)CHUNK_WIDTH),
-        (int)floorf((float)position.y / (float)CHUNK_WIDTH)
-    };
-
-    Vector2i localChunkPos = {
-        chunkPos.x - (currentChunkPos.x - chunk_view_width / 2),
-        chunkPos.y - (currentChunkPos.y - chunk_view_height / 2)
-    };
-
-    if (localChunkPos.x >= 0 && localChunkPos.x < chunk_view_width && localChunkPos.y >= 0 && localChunkPos.y < chunk_view_height) {
-        int chunkIndex = localChunkPos.y * chunk_view_width + localChunkPos.x;
-
+    Chunk* chunk = chunk_manager_get_chunk(block_to_chunk_pos(position));
+    if (chunk) {
         return chunk_get_block(
-            &chunks[chunkIndex],
+            chunk,
             (Vector2u){
                 .x = ((position.x % CHUNK_WIDTH) + CHUNK_WIDTH) % CHUNK_WIDTH,
                 .y = ((position.y % CHUNK_WIDTH) + CHUNK_WIDTH) % CHUNK_WIDTH
@@ -618,21 +1694,10 @@ BlockInstance chunk_manager_get_block(Vector2i position, ChunkLayerEnum layer) {
 uint8_t chunk_manager_get_light(Vector2i position) {
 	if (!initialized) return 0;
 
-    Vector2i chunkPos = {
-        (int)floorf((float)position.x / (float)CHUNK_WIDTH),
-        (int)floorf((float)position.y / (float)CHUNK_WIDTH)
-    };
-
-    Vector2i localChunkPos = {
-        chunkPos.x - (currentChunkPos.x - chunk_view_width / 2),
-        chunkPos.y - (currentChunkPos.y - chunk_view_height / 2)
-    };
-
-    if (localChunkPos.x >= 0 && localChunkPos.x < chunk_view_width && localChunkPos.y >= 0 && localChunkPos.y < chunk_view_height) {
-        int chunkIndex = localChunkPos.y * chunk_view_width + localChunkPos.x;
-
+    Chunk* chunk = chunk_manager_get_chunk(block_to_chunk_pos(position));
+    if (chunk) {
         return chunk_get_light(
-            &chunks[chunkIndex],
+            chunk,
             (Vector2u){
                 .x = ((position.x % CHUNK_WIDTH) + CHUNK_WIDTH) % CHUNK_WIDTH,
                 .y = ((position.y % CHUNK_WIDTH) + CHUNK_WIDTH) % CHUNK_WIDTH
@@ -645,21 +1710,10 @@ uint8_t chunk_manager_get_light(Vector2i position) {
 void chunk_manager_set_light(Vector2i position, uint8_t value) {
     if (!initialized) return;
 
-    Vector2i chunkPos = {
-        (int)floorf((float)position.x / (float)CHUNK_WIDTH),
-        (int)floorf((float)position.y / (float)CHUNK_WIDTH)
-    };
-
-    Vector2i localChunkPos = {
-        chunkPos.x - (currentChunkPos.x - chunk_view_width / 2),
-        chunkPos.y - (currentChunkPos.y - chunk_view_height / 2)
-    };
-
-    if (localChunkPos.x >= 0 && localChunkPos.x < chunk_view_width && localChunkPos.y >= 0 && localChunkPos.y < chunk_view_height) {
-        int chunkIndex = localChunkPos.y * chunk_view_width + localChunkPos.x;
-
+    Chunk* chunk = chunk_manager_get_chunk(block_to_chunk_pos(position));
+    if (chunk) {
         chunk_set_light(
-            &chunks[chunkIndex],
+            chunk,
             (Vector2u) {
                 .x = ((position.x % CHUNK_WIDTH) + CHUNK_WIDTH) % CHUNK_WIDTH,
                 .y = ((position.y % CHUNK_WIDTH) + CHUNK_WIDTH) % CHUNK_WIDTH
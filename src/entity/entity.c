@@ -180,8 +180,8 @@ static void resolve_solid_blocks(Entity* entity, float deltaTime) {
 			Rectangle collider_rects[MAX_RECTS_PER_COLLIDER];
 			size_t collider_count = 0;
 
-			BlockVariant variant = reg->variant_generator(block.state);
-			block_colliders_get_rects(variant.collider_idx, variant.rotation, &collider_count, collider_rects);
+			BlockVariant* variant = &br_get_block_variant(block.id, block.state)->variant;
+			block_colliders_get_rects(variant->collider_idx, variant->rotation, &collider_count, collider_rects);
 
 			for (size_t i = 0; i < collider_count; i++) {
 				Rectangle rect = collider_rects[i];
@@ -246,8 +246,8 @@ void resolve_area_blocks(Entity* entity) {
 				collider_count++;
 			}
 			else {
-				BlockVariant variant = reg->variant_generator(block.state);
-				block_colliders_get_rects(variant.collider_idx, variant.rotation, &collider_count, collider_rects);
+				BlockVariant* variant = &br_get_block_variant(block.id, block.state)->variant;
+				block_colliders_get_rects(variant->collider_idx, variant->rotation, &collider_count, collider_rects);
 			}
 
 			for (size_t i = 0; i < collider_count; i++) {
@@ -108,6 +108,9 @@ void game_update(float deltaTime) {
         currentChunkPos = cameraChunkPos;
     }
 
+    chunk_manager_update_loading();
+    chunk_manager_update_meshes(camera.target, get_game_settings()->mesh_budget_ms / 1000.0);
+
     if (demo_mode) {
         camera.target.x += 300.0f * deltaTime;
         return;
@@ -188,6 +191,9 @@ void game_update(float deltaTime) {
             }
         }
 
+        if (debug_info && IsKeyPressed(KEY_B)) chunk_manager_benchmark_meshing(100);
+        if (debug_info && IsKeyPressed(KEY_N) && !demo_mode) chunk_manager_benchmark_storage();
+
         if (debug_info && IsKeyPressed(KEY_C)) {
             Vector2i chunkPos = {
                 (int)floorf((float)mouseBlockPos.x / (float)CHUNK_WIDTH),
@@ -452,10 +458,15 @@ void game_draw() {
     }
 
     if (debug_info && draw_ui) {
+        ChunkCacheStats cacheStats = chunk_manager_get_cache_stats();
         sprintf(debug_text,
             "FPS: %d\n"
             "Loaded chunk area: %ux%u\n"
-            "Cached chunk count: %d\n"
+            "Cached chunks: %d (%.1f / %.0f MB)\n"
+            "Chunk cache hits: %u, misses: %u, evictions: %u\n"
+            "Loading chunks: %d\n"
+            "Saving chunks: %d\n"
+            "Pending chunk meshes: %d\n"
             "Camera chunk position: (%d, %d)\n"
             "Camera Zoom: %f\n"
             "Player position: (%f, %f)\n"
@@ -463,7 +474,11 @@ void game_draw() {
 
             GetFPS(),
             chunk_manager_get_view_width(), chunk_manager_get_view_height(),
-            chunk_manager_get_cached_chunk_count(),
+            cacheStats.count, cacheStats.bytes / (1024.0 * 1024.0), cacheStats.budget / (1024.0 * 1024.0),
+            cacheStats.hits, cacheStats.misses, cacheStats.evictions,
+            chunk_manager_get_loading_count(),
+            chunk_manager_get_saving_count(),
+            chunk_manager_get_dirty_mesh_count(),
 			currentChunkPos.x, currentChunkPos.y,
             camera.zoom,
             player->entity.rect.x, player->entity.rect.y,
@@ -510,6 +525,8 @@ void game_set_demo_mode(bool demo) {
             get_game_settings()->chunk_view_width,
             get_game_settings()->chunk_view_height
 		);
+        // The player is about to be spawned, so the ground under them has to be there
+        chunk_manager_finish_loading();
 
         if (player == NULL) {
             player = player_create(playerPosition, get_game_settings()->player_color);
@@ -21,6 +21,10 @@ static GameSettings settings = {
 	.wall_ao_brightness = 64,
 	.smooth_lighting = true,
 	.wall_ao = true,
+	.mesh_budget_ms = 4,
+	.chunk_cache_mb = 64,
+	.autosave_interval = 60,
+	.autosave_chunks = 256,
 };
 
 static TempGameSettings tempSettings;
@@ -38,6 +42,10 @@ void game_settings_to_temp() {
 	tempSettings.wall_ao_brightness = settings.wall_ao_brightness;
 	tempSettings.smooth_lighting = settings.smooth_lighting;
 	tempSettings.wall_ao = settings.wall_ao;
+	tempSettings.mesh_budget_ms = settings.mesh_budget_ms;
+	tempSettings.chunk_cache_mb = settings.chunk_cache_mb;
+	tempSettings.autosave_interval = settings.autosave_interval;
+	tempSettings.autosave_chunks = settings.autosave_chunks;
 }
 
 void temp_to_game_settings() {
@@ -53,6 +61,10 @@ void temp_to_game_settings() {
 	settings.wall_ao_brightness = (uint8_t)Clamp(tempSettings.wall_ao_brightness, 0.0f, 255.0f);
 	settings.smooth_lighting = tempSettings.smooth_lighting;
 	settings.wall_ao = tempSettings.wall_ao;
+	settings.mesh_budget_ms = (uint8_t)Clamp(tempSettings.mesh_budget_ms, 1, GAME_SETTINGS_MAX_MESH_BUDGET_MS);
+	settings.chunk_cache_mb = (uint16_t)Clamp(tempSettings.chunk_cache_mb, GAME_SETTINGS_MIN_CHUNK_CACHE_MB, GAME_SETTINGS_MAX_CHUNK_CACHE_MB);
+	settings.autosave_interval = (uint16_t)Clamp(tempSettings.autosave_interval, 0, GAME_SETTINGS_MAX_AUTOSAVE_INTERVAL);
+	settings.autosave_chunks = (uint16_t)Clamp(tempSettings.autosave_chunks, 0, GAME_SETTINGS_MAX_AUTOSAVE_CHUNKS);
 }
 
 bool save_game_settings() {
@@ -161,6 +173,18 @@ bool game_settings_draw(mu_Context* ctx) {
 			mu_label(ctx, "Wall Brightness");
 			mu_slider_ex(ctx, &tempSettings.wall_brightness, 0, 255, 1, "%.0f", MU_OPT_ALIGNCENTER);
 
+			mu_label(ctx, "Mesh Build Budget (ms)");
+			mu_slider_ex(ctx, &tempSettings.mesh_budget_ms, 1, GAME_SETTINGS_MAX_MESH_BUDGET_MS, 1, "%.0f", MU_OPT_ALIGNCENTER);
+
+			mu_label(ctx, "Chunk Cache Size (MB)");
+			mu_slider_ex(ctx, &tempSettings.chunk_cache_mb, GAME_SETTINGS_MIN_CHUNK_CACHE_MB, GAME_SETTINGS_MAX_CHUNK_CACHE_MB, GAME_SETTINGS_MIN_CHUNK_CACHE_MB, "%.0f", MU_OPT_ALIGNCENTER);
+
+			mu_label(ctx, "Autosave Interval (s, 0 = off)");
+			mu_slider_ex(ctx, &tempSettings.autosave_interval, 0, GAME_SETTINGS_MAX_AUTOSAVE_INTERVAL, 10, "%.0f", MU_OPT_ALIGNCENTER);
+
+			mu_label(ctx, "Autosave After Chunks (0 = off)");
+			mu_slider_ex(ctx, &tempSettings.autosave_chunks, 0, GAME_SETTINGS_MAX_AUTOSAVE_CHUNKS, 16, "%.0f", MU_OPT_ALIGNCENTER);
+
 			mu_layout_row(ctx, 2, (int[2]) { -32, -1 }, 30);
 
 			mu_label(ctx, "Smooth Lighting");
@@ -200,6 +224,10 @@ bool game_settings_draw(mu_Context* ctx) {
 			tempSettings.wall_ao_brightness = 64.0f;
 			tempSettings.smooth_lighting = true;
 			tempSettings.wall_ao = true;
+			tempSettings.mesh_budget_ms = 4.0f;
+			tempSettings.chunk_cache_mb = 64.0f;
+			tempSettings.autosave_interval = 60.0f;
+			tempSettings.autosave_chunks = 256.0f;
 		}
 		if (mu_button(ctx, "Apply")) {
 			game_settings_apply();
@@ -145,6 +145,18 @@ void item_container_create(ItemContainer* ic, char* name, uint8_t rows, uint8_t
 		ic->items[i] = (ItemSlot){ 0, 0 };
 }
 
+bool item_container_create_in_arena(ItemContainer* ic, Arena* arena, const char* name, uint8_t rows, uint8_t columns, bool immutable)
+{
+	if (!ic || !arena) return false;
+	ic->name = arena_strdup(arena, name);
+	ic->rows = rows;
+	ic->columns = columns;
+	ic->immutable = immutable;
+	// The arena gives back zeroed memory, so the slots are already empty
+	ic->items = arena_alloc(arena, ic->rows * ic->columns * sizeof(ItemSlot));
+	return ic->name && ic->items;
+}
+
 ItemSlot item_container_get_item(ItemContainer* ic, uint8_t row, uint8_t column)
 {
 	if (!ic) return (ItemSlot) { 0, 0 };
@@ -487,38 +499,46 @@ uint32_t item_container_serialized_size(ItemContainer* ic) {
 	return size;
 }
 
-void item_container_serialize(ItemContainer* ic, FILE* fileptr) {
-	if (!ic || !fileptr) return;
+void item_container_serialize(ItemContainer* ic, ByteWriter* writer) {
+	if (!ic || !writer) return;
 	
 	// Rows, columns and immutable
-	fwrite(&ic->rows, sizeof(uint8_t), 1, fileptr);
-	fwrite(&ic->columns, sizeof(uint8_t), 1, fileptr);
-	fwrite(&ic->immutable, sizeof(bool), 1, fileptr);
+	byte_writer_write_u8(writer, ic->rows);
+	byte_writer_write_u8(writer, ic->columns);
+	byte_writer_write(writer, &ic->immutable, sizeof(bool));
 
 	// Name string length + bytes
-	int namelen = strlen(ic->name) + 1;
-	fwrite(&namelen, sizeof(uint32_t), 1, fileptr);
-	fwrite(ic->name, sizeof(char), namelen, fileptr);
+	uint32_t namelen = strlen(ic->name) + 1;
+	byte_writer_write_u32(writer, namelen);
+	byte_writer_write(writer, ic->name, namelen);
 
 	// Items
-	fwrite(ic->items, sizeof(ItemSlot), ic->rows * ic->columns, fileptr);
+	byte_writer_write(writer, ic->items, sizeof(ItemSlot) * ic->rows * ic->columns);
 }
 
-void item_container_deserialize(ItemContainer* ic, FILE* fileptr) {
-	if (!ic || !fileptr) return;
+bool item_container_deserialize(ItemContainer* ic, ByteReader* reader, Arena* arena) {
+	if (!ic || !reader || !arena) return false;
+	ic->name = NULL;
+	ic->items = NULL;
+
 	// Rows, columns and immutable
-	fread(&ic->rows, sizeof(uint8_t), 1, fileptr);
-	fread(&ic->columns, sizeof(uint8_t), 1, fileptr);
-	fread(&ic->immutable, sizeof(bool), 1, fileptr);
+	ic->rows = byte_reader_read_u8(reader);
+	ic->columns = byte_reader_read_u8(reader);
+	byte_reader_read(reader, &ic->immutable, sizeof(bool));
 	// Name string length + bytes
-	uint32_t namelen = 0;
-	fread(&namelen, sizeof(uint32_t), 1, fileptr);
-	char* namebuf = calloc(namelen, sizeof(char));
-	if (namebuf) {
-		fread(namebuf, sizeof(char), namelen, fileptr);
-		ic->name = namebuf;
-	}
+	uint32_t namelen = byte_reader_read_u32(reader);
+	if (reader->failed || namelen == 0 || namelen > reader->size - reader->position) return false;
+
+	char* namebuf = arena_alloc(arena, namelen);
+	if (!namebuf) return false;
+	byte_reader_read(reader, namebuf, namelen);
+	namebuf[namelen - 1] = '\0';
+	ic->name = namebuf;
+
 	// Items
-	ic->items = calloc(ic->rows * ic->columns, sizeof(ItemSlot));
-	fread(ic->items, sizeof(ItemSlot), ic->rows * ic->columns, fileptr);
+	ic->items = arena_alloc(arena, ic->rows * ic->columns * sizeof(ItemSlot));
+	if (!ic->items) return false;
+	byte_reader_read(reader, ic->items, sizeof(ItemSlot) * ic->rows * ic->columns);
+
+	return !reader->failed;
 }
\ No newline at end of file
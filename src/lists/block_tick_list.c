@@ -1,63 +1,97 @@
 #include "lists/block_tick_list.h"
 #include "types.h"
 
-static inline bool is_equal(const BlockTickListEntry* a, const BlockTickListEntry* b) {
-    return a->position.x == b->position.x
-        && a->position.y == b->position.y
-        && a->layer == b->layer;
+#include <stdlib.h>
+#include <string.h>
+
+#include <raylib.h>
+
+static inline uint16_t pack(BlockTickListEntry entry) {
+    return (uint16_t)(entry.layer * CHUNK_AREA + entry.position.x + entry.position.y * CHUNK_WIDTH);
+}
+
+static inline BlockTickListEntry unpack(uint16_t packed) {
+    int idx = packed % CHUNK_AREA;
+    return (BlockTickListEntry) {
+        .position = { idx % CHUNK_WIDTH, idx / CHUNK_WIDTH },
+        .layer = (ChunkLayerEnum)(packed / CHUNK_AREA)
+    };
+}
+
+static inline bool has_bit(const BlockTickList* list, uint16_t packed) {
+    return (list->bits[packed / CHUNK_AREA][(packed % CHUNK_AREA) / 32] >> (packed % 32)) & 1u;
+}
+
+static inline void set_bit(BlockTickList* list, uint16_t packed, bool value) {
+    uint32_t* word = &list->bits[packed / CHUNK_AREA][(packed % CHUNK_AREA) / 32];
+    if (value) *word |= 1u << (packed % 32);
+    else *word &= ~(1u << (packed % 32));
 }
 
 void block_tick_list_clear(BlockTickList* list) {
     if (!list) return;
     list->count = 0;
+    memset(list->bits, 0, sizeof(list->bits));
 }
 
 bool block_tick_list_add(BlockTickList* list, BlockTickListEntry entry) {
     if (!list) return false;
 
-    for (size_t i = 0; i < list->count; i++) {
-        if (is_equal(&list->entries[i], &entry)) {
-            return true;
+    uint16_t packed = pack(entry);
+    if (has_bit(list, packed)) return true;
+
+    if (!list->slots) {
+        list->slots = malloc(sizeof(uint16_t) * BLOCK_TICK_LIST_MAX_COUNT);
+        if (!list->slots) {
+            TraceLog(LOG_ERROR, "Could not allocate memory for the block tick list.");
+            return false;
         }
     }
 
-    if (list->count >= TICKS_CAPACITY) {
-        return false;
+    // Every block can only be in the list once, so it never has to grow past the number of blocks
+    if (list->count >= list->capacity) {
+        unsigned int new_capacity = list->capacity > 0 ? list->capacity * 2 : BLOCK_TICK_LIST_INITIAL_CAPACITY;
+        if (new_capacity > BLOCK_TICK_LIST_MAX_COUNT) new_capacity = BLOCK_TICK_LIST_MAX_COUNT;
+        uint16_t* new_entries = realloc(list->entries, sizeof(uint16_t) * new_capacity);
+        if (!new_entries) {
+            TraceLog(LOG_ERROR, "Could not allocate memory for the block tick list.");
+            return false;
+        }
+        list->entries = new_entries;
+        list->capacity = new_capacity;
     }
 
-    list->entries[list->count++] = entry;
+    list->slots[packed] = (uint16_t)list->count;
+    list->entries[list->count++] = packed;
+    set_bit(list, packed, true);
     return true;
 }
 
 bool block_tick_list_remove(BlockTickList* list, BlockTickListEntry entry) {
     if (!list) return false;
 
-    for (size_t i = 0; i < list->count; i++) {
-        if (is_equal(&list->entries[i], &entry)) {
-            list->entries[i] = list->entries[list->count - 1];
-            list->count--;
-            return true;
-        }
-    }
-    return false;
+    uint16_t packed = pack(entry);
+    if (!has_bit(list, packed)) return false;
+    return block_tick_list_remove_by_index(list, list->slots[packed]);
 }
 
 bool block_tick_list_remove_by_index(BlockTickList* list, size_t index) {
     if (!list) return false;
     if (index >= list->count) return false;
-    list->entries[index] = list->entries[list->count - 1];
-    list->count--;
+
+    // The order doesn't matter, so the last entry takes its place
+    set_bit(list, list->entries[index], false);
+    uint16_t last = list->entries[--list->count];
+    if (index < list->count) {
+        list->entries[index] = last;
+        list->slots[last] = (uint16_t)index;
+    }
     return true;
 }
 
 bool block_tick_list_contains(BlockTickList* list, BlockTickListEntry entry) {
     if (!list) return false;
-    for (unsigned int i = 0; i < list->count; i++) {
-        if (is_equal(&list->entries[i], &entry)) {
-            return true;
-        }
-    }
-    return false;
+    return has_bit(list, pack(entry));
 }
 
 int block_tick_list_count(const BlockTickList* list) {
@@ -67,6 +101,17 @@ int block_tick_list_count(const BlockTickList* list) {
 bool block_tick_list_get(const BlockTickList* list, size_t index, BlockTickListEntry* out) {
     if (!list || !out) return false;
     if (index >= list->count) return false;
-    *out = list->entries[index];
+    *out = unpack(list->entries[index]);
     return true;
-}
\ No newline at end of file
+}
+
+void block_tick_list_free(BlockTickList* list) {
+    if (!list) return;
+    if (list->entries) free(list->entries);
+    if (list->slots) free(list->slots);
+    list->entries = NULL;
+    list->slots = NULL;
+    list->count = 0;
+    list->capacity = 0;
+    memset(list->bits, 0, sizeof(list->bits));
+}
@@ -0,0 +1,65 @@
+#include "lists/light_queue.h"
+
+#include <stdlib.h>
+
+#include <raylib.h>
+
+static bool grow(LightQueue* queue) {
+    size_t new_capacity = queue->capacity > 0 ? queue->capacity * 2 : LIGHT_QUEUE_INITIAL_CAPACITY;
+
+    LightQueueEntry* new_entries = malloc(sizeof(LightQueueEntry) * new_capacity);
+    if (!new_entries) {
+        TraceLog(LOG_ERROR, "Could not allocate memory for the light queue.");
+        return false;
+    }
+
+    // Unwrap the ring so the entries start at zero again
+    for (size_t i = 0; i < queue->count; i++) {
+        new_entries[i] = queue->entries[(queue->head + i) % queue->capacity];
+    }
+
+    free(queue->entries);
+    queue->entries = new_entries;
+    queue->capacity = new_capacity;
+    queue->head = 0;
+    return true;
+}
+
+void light_queue_clear(LightQueue* queue) {
+    if (!queue) return;
+    queue->head = 0;
+    queue->count = 0;
+}
+
+bool light_queue_push(LightQueue* queue, LightQueueEntry entry) {
+    if (!queue) return false;
+    if (queue->count >= queue->capacity) {
+        if (!grow(queue)) return false;
+    }
+
+    queue->entries[(queue->head + queue->count) % queue->capacity] = entry;
+    queue->count++;
+    return true;
+}
+
+bool light_queue_pop(LightQueue* queue, LightQueueEntry* out) {
+    if (!queue || queue->count == 0) return false;
+
+    if (out) *out = queue->entries[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    return true;
+}
+
+bool light_queue_is_empty(const LightQueue* queue) {
+    return !queue || queue->count == 0;
+}
+
+void light_queue_free(LightQueue* queue) {
+    if (!queue) return;
+    if (queue->entries) free(queue->entries);
+    queue->entries = NULL;
+    queue->head = 0;
+    queue->count = 0;
+    queue->capacity = 0;
+}
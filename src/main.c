@@ -135,6 +135,12 @@ int main() {
             }
 
             game_update(GetFrameTime());
+
+            // The world info goes with the chunks, so the player comes back to where they were saved
+            if (!game_is_demo_mode() && chunk_manager_update_autosave()) {
+                collect_game_info();
+                chunk_manager_save_world_info();
+            }
         }
 
         BeginDrawing();
@@ -2,11 +2,35 @@
 #include "block_functions.h"
 #include "block_states.h"
 #include "block_variants.h"
+#include "registries/block_models.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 
 static BlockRegistry* reg = NULL;
+static BlockVariantInfo* variants = NULL;
+
+static void bake_block_variants() {
+    variants = calloc(BLOCK_COUNT * BLOCK_STATE_COUNT, sizeof(BlockVariantInfo));
+    if (variants == NULL) {
+        TraceLog(LOG_ERROR, "Could not allocate memory for the block variant table.");
+        return;
+    }
+
+    for (int id = 0; id < BLOCK_COUNT; id++) {
+        BlockRegistry* br = &reg[id];
+        if (!br->variant_generator) continue;
+
+        bool opaque = br->lightLevel != BLOCK_LIGHT_TRANSPARENT && (br->flags & BLOCK_FLAG_FULL_BLOCK);
+
+        for (int state = 0; state < BLOCK_STATE_COUNT; state++) {
+            BlockVariantInfo* info = &variants[id * BLOCK_STATE_COUNT + state];
+            info->variant = br->variant_generator((uint8_t)state);
+            info->vertex_count = block_models_get_vertex_count(info->variant.model_idx);
+            info->opaque = opaque;
+        }
+    }
+}
 
 void block_registry_init() {
     reg = calloc(BLOCK_COUNT, sizeof(BlockRegistry));
@@ -104,7 +128,6 @@ void block_registry_init() {
         .lightLevel = BLOCK_LIGHT_NONE,
         .interact_callback = on_chest_interact,
         .state_resolver = chest_solver,
-        .free_data = chest_free_data,
         .data_size = chest_data_size,
         .data_serializer = chest_serialize_data,
         .data_deserializer = chest_deserialize_data
@@ -273,7 +296,6 @@ void block_registry_init() {
         .state_resolver = sign_solver,
         .overlay_draw = sign_text_draw,
         .interact_callback = sign_interact,
-        .free_data = sign_free_data,
         .data_size = sign_data_size,
         .data_serializer = sign_serialize_data,
         .data_deserializer = sign_deserialize_data
@@ -383,6 +405,9 @@ void block_registry_init() {
         .lightLevel = BLOCK_LIGHT_NONE,
         .state_resolver = powered_lamp_solver
     };
+
+    // Must be last, since it reads from the registry entries above
+    bake_block_variants();
 }
 
 BlockRegistry* br_get_block_registry(size_t idx) {
@@ -390,6 +415,13 @@ BlockRegistry* br_get_block_registry(size_t idx) {
     return &reg[idx];
 }
 
+BlockVariantInfo* br_get_block_variant(uint8_t id, uint8_t state) {
+    if (id > BLOCK_COUNT - 1 || !variants) return NULL;
+    return &variants[id * BLOCK_STATE_COUNT + state];
+}
+
 void block_registry_free() {
 	if (reg) free(reg);
+	if (variants) free(variants);
+	variants = NULL;
 }
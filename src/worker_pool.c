@@ -0,0 +1,308 @@
+#include "worker_pool.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+typedef HANDLE Thread;
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Condition;
+
+static bool mutex_init(Mutex* m) { InitializeCriticalSection(m); return true; }
+static void mutex_destroy(Mutex* m) { DeleteCriticalSection(m); }
+static void mutex_lock(Mutex* m) { EnterCriticalSection(m); }
+static void mutex_unlock(Mutex* m) { LeaveCriticalSection(m); }
+
+static bool condition_init(Condition* c) { InitializeConditionVariable(c); return true; }
+static void condition_destroy(Condition* c) { (void)c; }
+static void condition_wait(Condition* c, Mutex* m) { SleepConditionVariableCS(c, m, INFINITE); }
+static void condition_broadcast(Condition* c) { WakeAllConditionVariable(c); }
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_t Thread;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Condition;
+
+static bool mutex_init(Mutex* m) { return pthread_mutex_init(m, NULL) == 0; }
+static void mutex_destroy(Mutex* m) { pthread_mutex_destroy(m); }
+static void mutex_lock(Mutex* m) { pthread_mutex_lock(m); }
+static void mutex_unlock(Mutex* m) { pthread_mutex_unlock(m); }
+
+static bool condition_init(Condition* c) { return pthread_cond_init(c, NULL) == 0; }
+static void condition_destroy(Condition* c) { pthread_cond_destroy(c); }
+static void condition_wait(Condition* c, Mutex* m) { pthread_cond_wait(c, m); }
+static void condition_broadcast(Condition* c) { pthread_cond_broadcast(c); }
+#endif
+
+typedef struct WorkerJob {
+    WorkerJobFunc work;
+    WorkerJobFunc done;
+    void* data;
+    struct WorkerJob* next;
+} WorkerJob;
+
+// Simple FIFO linked list of jobs
+typedef struct {
+    WorkerJob* first;
+    WorkerJob* last;
+} WorkerJobList;
+
+struct WorkerPool {
+    Thread* threads;
+    int thread_count;
+
+    Mutex mutex;
+    // Signaled when a job is queued or when the pool is stopping
+    Condition job_available;
+    // Signaled when a job finishes running
+    Condition job_finished;
+
+    WorkerJobList queued;
+    WorkerJobList finished;
+
+    // Jobs that are being run right now
+    int running_count;
+    // Jobs that were submitted and still didn't get polled
+    int pending_count;
+    bool stopping;
+};
+
+static void job_list_push(WorkerJobList* list, WorkerJob* job) {
+    job->next = NULL;
+    if (list->last) list->last->next = job;
+    else list->first = job;
+    list->last = job;
+}
+
+static WorkerJob* job_list_pop(WorkerJobList* list) {
+    WorkerJob* job = list->first;
+    if (!job) return NULL;
+
+    list->first = job->next;
+    if (!list->first) list->last = NULL;
+    job->next = NULL;
+    return job;
+}
+
+static void worker_loop(WorkerPool* pool) {
+    mutex_lock(&pool->mutex);
+
+    while (true) {
+        while (!pool->queued.first && !pool->stopping) {
+            condition_wait(&pool->job_available, &pool->mutex);
+        }
+
+        WorkerJob* job = job_list_pop(&pool->queued);
+        if (!job) break; // Stopping and there is nothing else to do
+
+        pool->running_count++;
+        mutex_unlock(&pool->mutex);
+
+        if (job->work) job->work(job->data);
+
+        mutex_lock(&pool->mutex);
+        pool->running_count--;
+        job_list_push(&pool->finished, job);
+        condition_broadcast(&pool->job_finished);
+    }
+
+    mutex_unlock(&pool->mutex);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_main(LPVOID arg) {
+    worker_loop((WorkerPool*)arg);
+    return 0;
+}
+
+static bool thread_start(Thread* thread, WorkerPool* pool) {
+    *thread = CreateThread(NULL, 0, worker_main, pool, 0, NULL);
+    return *thread != NULL;
+}
+
+static void thread_join(Thread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+int worker_pool_get_cpu_count() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+#else
+static void* worker_main(void* arg) {
+    worker_loop((WorkerPool*)arg);
+    return NULL;
+}
+
+static bool thread_start(Thread* thread, WorkerPool* pool) {
+    return pthread_create(thread, NULL, worker_main, pool) == 0;
+}
+
+static void thread_join(Thread thread) {
+    pthread_join(thread, NULL);
+}
+
+int worker_pool_get_cpu_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+#endif
+
+WorkerPool* worker_pool_create(int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = worker_pool_get_cpu_count() - 1;
+        if (thread_count < 1) thread_count = 1;
+    }
+
+    WorkerPool* pool = calloc(1, sizeof(WorkerPool));
+    if (!pool) return NULL;
+
+    pool->threads = calloc(thread_count, sizeof(Thread));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+
+    if (!mutex_init(&pool->mutex)) {
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    if (!condition_init(&pool->job_available) || !condition_init(&pool->job_finished)) {
+        mutex_destroy(&pool->mutex);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < thread_count; i++) {
+        if (!thread_start(&pool->threads[i], pool)) break;
+        pool->thread_count++;
+    }
+
+    if (pool->thread_count == 0) {
+        worker_pool_destroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+bool worker_pool_submit(WorkerPool* pool, WorkerJobFunc work, WorkerJobFunc done, void* data) {
+    if (!pool) return false;
+
+    WorkerJob* job = malloc(sizeof(WorkerJob));
+    if (!job) return false;
+
+    job->work = work;
+    job->done = done;
+    job->data = data;
+
+    mutex_lock(&pool->mutex);
+    job_list_push(&pool->queued, job);
+    pool->pending_count++;
+    condition_broadcast(&pool->job_available);
+    mutex_unlock(&pool->mutex);
+
+    return true;
+}
+
+int worker_pool_poll(WorkerPool* pool, int max) {
+    if (!pool) return 0;
+
+    int count = 0;
+    while (max <= 0 || count < max) {
+        mutex_lock(&pool->mutex);
+        WorkerJob* job = job_list_pop(&pool->finished);
+        if (job) pool->pending_count--;
+        mutex_unlock(&pool->mutex);
+
+        if (!job) break;
+
+        // Called without holding the lock, so it can submit new jobs
+        if (job->done) job->done(job->data);
+        free(job);
+        count++;
+    }
+
+    return count;
+}
+
+int worker_pool_get_pending_count(WorkerPool* pool) {
+    if (!pool) return 0;
+
+    mutex_lock(&pool->mutex);
+    int count = pool->pending_count;
+    mutex_unlock(&pool->mutex);
+    return count;
+}
+
+int worker_pool_get_thread_count(WorkerPool* pool) {
+    return pool ? pool->thread_count : 0;
+}
+
+void worker_pool_wait(WorkerPool* pool) {
+    if (!pool) return;
+
+    mutex_lock(&pool->mutex);
+    while (pool->queued.first || pool->running_count > 0) {
+        condition_wait(&pool->job_finished, &pool->mutex);
+    }
+    mutex_unlock(&pool->mutex);
+}
+
+void worker_pool_destroy(WorkerPool* pool) {
+    if (!pool) return;
+
+    worker_pool_wait(pool);
+    worker_pool_poll(pool, 0);
+
+    mutex_lock(&pool->mutex);
+    pool->stopping = true;
+    condition_broadcast(&pool->job_available);
+    mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->thread_count; i++) thread_join(pool->threads[i]);
+
+    condition_destroy(&pool->job_available);
+    condition_destroy(&pool->job_finished);
+    mutex_destroy(&pool->mutex);
+
+    free(pool->threads);
+    free(pool);
+}
+
+struct WorkerMutex {
+    Mutex mutex;
+};
+
+WorkerMutex* worker_mutex_create() {
+    WorkerMutex* mutex = malloc(sizeof(WorkerMutex));
+    if (!mutex) return NULL;
+
+    if (!mutex_init(&mutex->mutex)) {
+        free(mutex);
+        return NULL;
+    }
+    return mutex;
+}
+
+void worker_mutex_lock(WorkerMutex* mutex) {
+    if (mutex) mutex_lock(&mutex->mutex);
+}
+
+void worker_mutex_unlock(WorkerMutex* mutex) {
+    if (mutex) mutex_unlock(&mutex->mutex);
+}
+
+void worker_mutex_destroy(WorkerMutex* mutex) {
+    if (!mutex) return;
+    mutex_destroy(&mutex->mutex);
+    free(mutex);
+}
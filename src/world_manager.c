@@ -5,9 +5,29 @@
 #include "sign_editor.h"
 #include "raylib.h"
 #include "types.h"
+#include "worker_pool.h"
+#include "byte_buffer.h"
+#include "chunk_codec.h"
+#include "thirdparty/uthash.h"
 
 #include <errno.h>
 
+#ifdef _WIN32
+#include <io.h>
+// windows.h conflicts with raylib, so only the function that replaces files is declared here
+__declspec(dllimport) int __stdcall MoveFileExA(const char* existingFileName, const char* newFileName, unsigned long flags);
+#define MOVEFILE_REPLACE_EXISTING 0x00000001
+#define MOVEFILE_WRITE_THROUGH 0x00000008
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+// Region files are read through a memory mapping. Windows (where the mapping functions
+// come from windows.h, which conflicts with raylib) reads them with stdio instead.
+#define REGION_MMAP
+#endif
+
 #include <limits.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -33,6 +53,73 @@ bool creatingWorld = false;
 
 WorldInfo tempWorldInfo;
 
+// Chunks are loaded from the worker threads and saved from the main thread,
+// so everything about the region files happens while holding this lock.
+static WorkerMutex* regionMutex = NULL;
+
+static void load_chunk_index(const char* worldDir, bool readOnly);
+
+// Makes sure what was written to the file is on the disk, and not only in the OS cache.
+static bool sync_file(FILE* file) {
+    if (fflush(file) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Files that are created or renamed are only on the disk once their directory is too.
+// Windows has no way of doing this (and doesn't need it).
+static void sync_directory(const char* dir) {
+#ifndef _WIN32
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+#else
+    (void)dir;
+#endif
+}
+
+// Writes the whole file to a temporary file next to it, and only then puts it in place of the old one,
+// so a crash leaves either the old file or the new one, never a part of it.
+static bool write_file_atomic(const char* path, const void* data, size_t size) {
+    char tmpPath[512];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+    FILE* fptr = fopen(tmpPath, "wb");
+    if (!fptr) return false;
+
+    bool ok = fwrite(data, 1, size, fptr) == size && sync_file(fptr);
+    if (fclose(fptr) != 0) ok = false;
+    if (!ok) {
+        remove(tmpPath);
+        return false;
+    }
+
+#ifdef _WIN32
+    // rename doesn't replace files on Windows, and removing the old file first would leave neither in place for a moment
+    bool renamed = MoveFileExA(tmpPath, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bool renamed = rename(tmpPath, path) == 0;
+#endif
+    if (!renamed) {
+        remove(tmpPath);
+        return false;
+    }
+
+    // GetDirectoryPath isn't thread safe
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char* slash = strrchr(dir, '/');
+    if (slash) {
+        *slash = '\0';
+        sync_directory(dir);
+    }
+    return true;
+}
+
 int combobox(mu_Context* ctx, int item_count, const char* items[], int* item_idx) {
     mu_Id id = mu_get_id(ctx, items, sizeof(const char*) * item_count);
     mu_Rect rect = mu_layout_next(ctx);
@@ -148,10 +235,16 @@ void world_manager_init() {
 	memset(&worldInfo, 0, sizeof(WorldInfo));
     memset(&tempWorldInfo, 0, sizeof(WorldInfo));
 
+    if (!regionMutex) {
+        regionMutex = worker_mutex_create();
+        if (!regionMutex) TraceLog(LOG_ERROR, "Could not create the region file lock.");
+    }
+
     world_manager_load_world_list();
 }
 
 bool world_manager_create_world(WorldInfo info) {
+    info.version = WORLD_VERSION;
     char* dirName = TextReplace(TextToLower(info.name), " ", "_");
 
     if (DirectoryExists(TextFormat("worlds/%s", dirName))) {
@@ -166,18 +259,17 @@ bool world_manager_create_world(WorldInfo info) {
         return false;
 	}
 
-    if (MakeDirectory(TextFormat("%s/chunks", worldDir)) != 0) {
-        TraceLog(LOG_ERROR, "Could not create chunks directory (%s/chunks): %s", worldDir, strerror(errno));
+    if (MakeDirectory(TextFormat("%s/regions", worldDir)) != 0) {
+        TraceLog(LOG_ERROR, "Could not create regions directory (%s/regions): %s", worldDir, strerror(errno));
         return false;
 	}
 
-    FILE* fptr = fopen(TextFormat("%s/worldinfo.bin", worldDir), "wb");
-    if (!fptr) {
-        TraceLog(LOG_ERROR, "Could not create world info (%s/worldinfo.bin): %s", worldDir, strerror(errno));
+    char path[512];
+    snprintf(path, sizeof(path), "%s/worldinfo.bin", worldDir);
+    if (!write_file_atomic(path, &info, sizeof(WorldInfo))) {
+        TraceLog(LOG_ERROR, "Could not create world info (%s): %s", path, strerror(errno));
         return false;
     }
-    fwrite(&info, sizeof(WorldInfo), 1, fptr);
-    fclose(fptr);
 
     free(dirName);
     return true;
@@ -194,18 +286,24 @@ bool world_manager_save_world_info() {
         return false;
     }
 
-	FILE* fptr = fopen(TextFormat("%s/worldinfo.bin", currentWorldDir), "wb");
-    if (!fptr) {
-        TraceLog(LOG_ERROR, "Could not save world info (%s/worldinfo.bin): %s", currentWorldDir, strerror(errno));
+    return world_manager_write_world_info(currentWorldDir, &worldInfo);
+}
+
+bool world_manager_write_world_info(const char* worldDir, const WorldInfo* info) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/worldinfo.bin", worldDir);
+    if (!write_file_atomic(path, info, sizeof(WorldInfo))) {
+        TraceLog(LOG_ERROR, "Could not save world info (%s): %s", path, strerror(errno));
         return false;
     }
-	fwrite(&worldInfo, sizeof(WorldInfo), 1, fptr);
-	fclose(fptr);
     return true;
 }
 
-bool world_manager_load_world_info(const char* worldDir) {
+// Reads the world info and the chunk index. Unless it's read only, the world is upgraded to the current version
+// and the chunks of older versions are moved to region files.
+static bool load_world_info(const char* worldDir, bool readOnly) {
     if (currentWorldDir) free(currentWorldDir);
+    currentWorldDir = NULL;
 
 	char* tmp = formatted_string("%s", worldDir);
 
@@ -221,75 +319,739 @@ bool world_manager_load_world_info(const char* worldDir) {
         free(tmp);
         return false;
     }
-    fread(&worldInfo, sizeof(WorldInfo), 1, fptr);
+    bool read = fread(&worldInfo, sizeof(WorldInfo), 1, fptr) == 1;
 	fclose(fptr);
 
-    if (worldInfo.version != WORLD_VERSION) {
-        TraceLog(LOG_ERROR, "Refused to load the world info because it is saved in another version.\nWorld version: %d\nCurrent version: %d", tmp, worldInfo.version, WORLD_VERSION);
+    if (!read) {
+        TraceLog(LOG_ERROR, "Could not load world info (%s/worldinfo.bin): the file is too short.", tmp);
+        memset(&worldInfo, 0, sizeof(WorldInfo));
         free(tmp);
         return false;
     }
 
+    if (worldInfo.version > WORLD_VERSION) {
+        TraceLog(LOG_ERROR, "Refused to load the world info because it is saved in a newer version.\nWorld version: %d\nCurrent version: %d", worldInfo.version, WORLD_VERSION);
+        free(tmp);
+        return false;
+    }
+    // Older chunks are still readable, and get saved with the new version as they are saved again
+    if (!readOnly && worldInfo.version < WORLD_VERSION) {
+        TraceLog(LOG_INFO, "Upgrading world %s from version %d to %d.", tmp, worldInfo.version, WORLD_VERSION);
+        worldInfo.version = WORLD_VERSION;
+    }
+
+    // Converted chunks aren't in the index file, so it gets built again
+    if (!readOnly && world_manager_convert_legacy_chunks(tmp) > 0) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/regions/index.bin", tmp);
+        remove(path);
+    }
+    load_chunk_index(tmp, readOnly);
+
 	currentWorldDir = tmp;
     return true;
 }
 
-bool world_manager_save_chunk(Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
-    if (!currentWorldDir) return false;
-    
-    FILE* fptr = fopen(TextFormat("%s/chunks/%d_%d.bin", currentWorldDir, position.x, position.y), "wb");
-    if (!fptr) {
-        TraceLog(LOG_ERROR, "Could not save chunk at position (%d, %d): %s", position.x, position.y, strerror(errno));
-        return false;
+bool world_manager_load_world_info(const char* worldDir) {
+    return load_world_info(worldDir, false);
+}
+
+bool world_manager_load_world_info_read_only(const char* worldDir) {
+    return load_world_info(worldDir, true);
+}
+
+// Serializes a chunk record at the end of the writer:
+//
+//     uint8 version
+//     uint16 encoding size, then the blocks of both layers encoded with chunk_codec
+//     uint16 data count, then (uint16 block index, uint32 data size, the data itself) for every block with data
+//
+// The block index goes through the background layer and then the foreground layer.
+//
+// Chunks where every block is the same (all air, all stone...) and none of them have data
+// are saved as just the version followed by uint8 id, uint8 state. Those are the only records with 3 bytes.
+#define UNIFORM_RECORD_SIZE 3
+
+static void write_chunk_record(ByteWriter* writer, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    BlockInstance uniformBlock;
+    if (chunk_codec_is_uniform(layers, &uniformBlock)) {
+        byte_writer_write_u8(writer, WORLD_VERSION);
+        byte_writer_write_u8(writer, uniformBlock.id);
+        byte_writer_write_u8(writer, uniformBlock.state);
+        return;
     }
 
-	uint32_t baseOffset = sizeof(uint8_t) + ((sizeof(uint8_t) * 2 + sizeof(uint32_t)) * CHUNK_AREA * CHUNK_LAYER_COUNT);
-    uint32_t dataOffset = baseOffset;
-    uint32_t zero = 0;
+    uint8_t encoded[CHUNK_CODEC_MAX_SIZE];
+    size_t encodedSize = chunk_codec_encode(layers, encoded);
+
+    byte_writer_write_u8(writer, WORLD_VERSION);
+    byte_writer_write_u16(writer, (uint16_t)encodedSize);
+    byte_writer_write(writer, encoded, encodedSize);
 
-    uint8_t version = WORLD_VERSION;
-    fwrite(&version, sizeof(uint8_t), 1, fptr);
+    size_t countPos = writer->size;
+    uint16_t dataCount = 0;
+    byte_writer_write_u16(writer, 0);
 
     for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
-        for (int b = 0; b < CHUNK_AREA; b++) {
-			fwrite(&layers[l].blocks[b].id, sizeof(uint8_t), 1, fptr);
-            fwrite(&layers[l].blocks[b].state, sizeof(uint8_t), 1, fptr);
-
-            if (layers[l].blocks[b].data) {
-                BlockRegistry* reg = br_get_block_registry(layers[l].blocks[b].id);
-                if (reg && reg->data_size) {
-                    fwrite(&dataOffset, sizeof(uint32_t), 1, fptr);
-                    dataOffset += reg->data_size(layers[l].blocks[b].data);
-                } else {
-                    fwrite(&zero, sizeof(uint32_t), 1, fptr);
-                }
-            }
-            else {
-				fwrite(&zero, sizeof(uint32_t), 1, fptr);
+        for (int d = 0; d < layers[l].dataCount; d++) {
+            BlockDataEntry entry = layers[l].data[d];
+
+            BlockRegistry* reg = br_get_block_registry(layers[l].ids[entry.idx]);
+            if (!reg || !reg->data_serializer) continue;
+
+            byte_writer_write_u16(writer, (uint16_t)(l * CHUNK_AREA + entry.idx));
+            size_t sizePos = writer->size;
+            byte_writer_write_u32(writer, 0);
+
+            reg->data_serializer(entry.data, writer);
+            if (writer->failed) return;
+
+            // The size is only known once the data is written
+            uint32_t dataSize = (uint32_t)(writer->size - sizePos - sizeof(uint32_t));
+            memcpy(writer->data + sizePos, &dataSize, sizeof(uint32_t));
+            dataCount++;
+        }
+	}
+
+    if (!writer->failed) memcpy(writer->data + countPos, &dataCount, sizeof(uint16_t));
+}
+
+static ChunkLoadStatus read_chunk_record_v1(ByteReader* reader, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    uint16_t encodedSize = byte_reader_read_u16(reader);
+    if (reader->failed || encodedSize > reader->size - reader->position) return CHUNK_LOAD_ERROR_FATAL;
+    if (!chunk_codec_decode(reader->data + reader->position, encodedSize, layers)) return CHUNK_LOAD_ERROR_FATAL;
+    byte_reader_seek(reader, reader->position + encodedSize);
+
+    uint16_t dataCount = byte_reader_read_u16(reader);
+    for (int i = 0; i < dataCount; i++) {
+        uint16_t index = byte_reader_read_u16(reader);
+        uint32_t dataSize = byte_reader_read_u32(reader);
+        if (reader->failed || index >= CHUNK_CODEC_BLOCK_COUNT || dataSize > reader->size - reader->position) {
+            return CHUNK_LOAD_ERROR_FATAL;
+        }
+
+        ChunkLayer* layer = &layers[index / CHUNK_AREA];
+        int idx = index % CHUNK_AREA;
+        BlockRegistry* reg = br_get_block_registry(layer->ids[idx]);
+        if (reg && reg->data_deserializer && !chunk_layer_get_data(layer, idx)) {
+            // The deserializer only gets to see its own data
+            ByteReader dataReader = byte_reader_create(reader->data + reader->position, dataSize);
+            void* data = reg->data_deserializer(&dataReader, &layer->arena);
+            if (data && !chunk_layer_set_data(layer, idx, data)) {
+                if (reg->free_data) reg->free_data(data);
+                return CHUNK_LOAD_ERROR_FATAL;
             }
         }
+
+        byte_reader_seek(reader, reader->position + dataSize);
+    }
+
+    return reader->failed ? CHUNK_LOAD_ERROR_FATAL : CHUNK_LOAD_SUCCESS;
+}
+
+static ChunkLoadStatus read_uniform_chunk_record(ByteReader* reader, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    uint8_t id = byte_reader_read_u8(reader);
+    uint8_t state = byte_reader_read_u8(reader);
+    if (reader->failed) return CHUNK_LOAD_ERROR_FATAL;
+
+    for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+        memset(layers[l].ids, id, sizeof(layers[l].ids));
+        memset(layers[l].states, state, sizeof(layers[l].states));
     }
+    return CHUNK_LOAD_SUCCESS;
+}
 
+// Version 0 records have every block with its id, state and data offset (relative to the start of the record),
+// followed by the data.
+static ChunkLoadStatus read_chunk_record_v0(ByteReader* reader, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
     for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
         for (int b = 0; b < CHUNK_AREA; b++) {
-            if (layers[l].blocks[b].data) {
-                BlockRegistry* reg = br_get_block_registry(layers[l].blocks[b].id);
-                if (reg && reg->data_serializer) {
-                    reg->data_serializer(layers[l].blocks[b].data, fptr);
+            layers[l].ids[b] = byte_reader_read_u8(reader);
+            layers[l].states[b] = byte_reader_read_u8(reader);
+            uint32_t dataOffset = byte_reader_read_u32(reader);
+
+            if (dataOffset != 0) {
+                size_t currentPos = reader->position;
+                BlockRegistry* reg = br_get_block_registry(layers[l].ids[b]);
+                if (reg && reg->data_deserializer && byte_reader_seek(reader, dataOffset)) {
+                    void* data = reg->data_deserializer(reader, &layers[l].arena);
+                    if (data && !chunk_layer_set_data(&layers[l], b, data)) {
+                        if (reg->free_data) reg->free_data(data);
+                        return CHUNK_LOAD_ERROR_FATAL;
+                    }
                 }
+                byte_reader_seek(reader, currentPos);
             }
         }
-	}
+    }
 
-    fclose(fptr);
-    
+    return reader->failed ? CHUNK_LOAD_ERROR_FATAL : CHUNK_LOAD_SUCCESS;
+}
+
+// Reads a chunk record from the start of the reader.
+// Records of older versions are read as they are, and the chunk is saved with the current version next time.
+static ChunkLoadStatus read_chunk_record(ByteReader* reader, Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    uint8_t version = byte_reader_read_u8(reader);
+
+    ChunkLoadStatus status;
+    switch (version) {
+        case 0: status = read_chunk_record_v0(reader, layers); break;
+        case 1: status = read_chunk_record_v1(reader, layers); break;
+        // Version 2 only added the uniform records
+        case 2:
+            if (reader->size == UNIFORM_RECORD_SIZE) status = read_uniform_chunk_record(reader, layers);
+            else status = read_chunk_record_v1(reader, layers);
+            break;
+        default:
+            TraceLog(LOG_ERROR, "Refused to load chunk (%d, %d) because its saved in a newer version.\nChunk version: %d\nCurrent version: %d", position.x, position.y, version, WORLD_VERSION);
+            return CHUNK_LOAD_ERROR_FATAL;
+    }
+
+    if (status != CHUNK_LOAD_SUCCESS) {
+        TraceLog(LOG_ERROR, "Could not load chunk (%d, %d) because its data is malformed.", position.x, position.y);
+        for (int l = 0; l < CHUNK_LAYER_COUNT; l++) chunk_layer_free_block_data(&layers[l]);
+    }
+
+    return status;
+}
+
+// Regions pack REGION_WIDTH x REGION_WIDTH chunks in a single file.
+// The file starts with a table with the sector and length of every chunk, and each chunk record
+// takes a run of whole sectors after it.
+//
+// Records are never written over the ones the table points to. A new record goes to free sectors,
+// and the table only points to it once it is committed (see world_manager_commit_chunks),
+// so if the game crashes, every chunk still has its last committed record.
+#define REGION_WIDTH 32
+#define REGION_CHUNK_COUNT (REGION_WIDTH * REGION_WIDTH)
+// Most records are well under a hundred bytes, so small sectors waste less space
+#define REGION_SECTOR_SIZE 256
+#define REGION_HEADER_SECTORS ((REGION_CHUNK_COUNT * sizeof(RegionEntry) + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE)
+// Region files kept open at the same time
+#define MAX_OPEN_REGIONS 8
+
+typedef struct {
+    // First sector of the record, zero if the chunk was never saved
+    uint32_t sector;
+    // Length of the record in bytes
+    uint32_t length;
+} RegionEntry;
+
+// Records are decoded from the mapping without holding the lock, so every reader keeps a reference to it.
+// The mapping is only unmapped once the region dropped it (because the file grew or was closed) and the last reader is done.
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    // Guarded by the region lock
+    int refs;
+} RegionMap;
+
+typedef struct {
+    Vector2i position;
+    FILE* file;
+    // The table that is on the disk
+    RegionEntry entries[REGION_CHUNK_COUNT];
+    // Records that were written but aren't in the table yet (with sector zero if there is none)
+    RegionEntry pending[REGION_CHUNK_COUNT];
+    int pendingCount;
+    // The file itself was created since the last commit, so its directory has to be synced too
+    bool created;
+    char directory[512];
+    // Read only mapping of the file, NULL if it isn't mapped. It grows with the file when needed.
+    RegionMap* map;
+    unsigned int lastUse;
+} RegionFile;
+
+static RegionFile openRegions[MAX_OPEN_REGIONS];
+static unsigned int regionUseCounter = 0;
+
+// Chunk records are built here and then written all at once.
+// Only the main thread serializes chunks, so it doesn't need the lock.
+static ByteWriter recordWriter = { 0 };
+
+// Which chunks of the current world were ever saved, so chunks that never were
+// can be generated without touching the disk. Guarded by the region lock too.
+typedef struct {
+    // Position of the region
+    Vector2i position;
+    uint32_t saved[REGION_CHUNK_COUNT / 32];
+    UT_hash_handle hh;
+} ChunkIndexEntry;
+
+static ChunkIndexEntry* chunkIndex = NULL;
+
+static int floor_div(int value, int divisor) {
+    return (value >= 0) ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+static int region_chunk_index(Vector2i position) {
+    int x = position.x - floor_div(position.x, REGION_WIDTH) * REGION_WIDTH;
+    int y = position.y - floor_div(position.y, REGION_WIDTH) * REGION_WIDTH;
+    return x + y * REGION_WIDTH;
+}
+
+static ChunkIndexEntry* get_index_entry(Vector2i regionPosition, bool create) {
+    ChunkIndexEntry* entry = NULL;
+    HASH_FIND(hh, chunkIndex, &regionPosition, sizeof(Vector2i), entry);
+    if (entry || !create) return entry;
+
+    entry = calloc(1, sizeof(ChunkIndexEntry));
+    if (!entry) return NULL;
+    entry->position = regionPosition;
+    HASH_ADD(hh, chunkIndex, position, sizeof(Vector2i), entry);
+    return entry;
+}
+
+// Must be called while holding the lock
+static void index_chunk(Vector2i position) {
+    Vector2i region = { floor_div(position.x, REGION_WIDTH), floor_div(position.y, REGION_WIDTH) };
+    ChunkIndexEntry* entry = get_index_entry(region, true);
+    if (!entry) {
+        TraceLog(LOG_ERROR, "Could not allocate memory for the chunk index.");
+        return;
+    }
+
+    int index = region_chunk_index(position);
+    entry->saved[index / 32] |= 1u << (index % 32);
+}
+
+static void clear_chunk_index() {
+    ChunkIndexEntry *entry, *tmp;
+    HASH_ITER(hh, chunkIndex, entry, tmp) {
+        HASH_DEL(chunkIndex, entry);
+        free(entry);
+    }
+}
+
+// Puts the pending records in the table. The records are synced before the table is written,
+// so it never points to a record that isn't on the disk. Must be called while holding the lock.
+static bool commit_region(RegionFile* region) {
+    if (!region->file || region->pendingCount == 0) return true;
+
+    if (!sync_file(region->file)) {
+        TraceLog(LOG_ERROR, "Could not commit region (%d, %d): %s", region->position.x, region->position.y, strerror(errno));
+        return false;
+    }
+    if (region->created) {
+        sync_directory(region->directory);
+        region->created = false;
+    }
+
+    for (int i = 0; i < REGION_CHUNK_COUNT; i++) {
+        if (region->pending[i].sector != 0) region->entries[i] = region->pending[i];
+    }
+    memset(region->pending, 0, sizeof(region->pending));
+    region->pendingCount = 0;
+
+    // Each entry is small enough to be written whole, so even a torn table only mixes old and new records,
+    // and the old ones are still there since their sectors weren't free until now
+    bool ok = fseek(region->file, 0, SEEK_SET) == 0
+        && fwrite(region->entries, sizeof(RegionEntry), REGION_CHUNK_COUNT, region->file) == REGION_CHUNK_COUNT
+        && sync_file(region->file);
+
+    if (!ok) TraceLog(LOG_ERROR, "Could not write the table of region (%d, %d): %s", region->position.x, region->position.y, strerror(errno));
+    return ok;
+}
+
+// Must be called while holding the lock.
+static void release_region_map(RegionMap* map) {
+    if (--map->refs > 0) return;
+#ifdef REGION_MMAP
+    munmap((void*)map->data, map->size);
+#endif
+    free(map);
+}
+
+static void unmap_region(RegionFile* region) {
+    if (region->map) release_region_map(region->map);
+    region->map = NULL;
+}
+
+// Makes sure the mapping reaches the given size, mapping the file again if it grew.
+// Returns false if the region can't be mapped, and it has to be read with stdio. Must be called while holding the lock.
+static bool map_region(RegionFile* region, size_t size) {
+#ifdef REGION_MMAP
+    if (region->map && region->map->size >= size) return true;
+
+    // Unbuffered writes go straight to the file, so its size is up to date
+    struct stat st;
+    if (fstat(fileno(region->file), &st) != 0 || (size_t)st.st_size < size) return false;
+
+    RegionMap* map = malloc(sizeof(RegionMap));
+    if (!map) return false;
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fileno(region->file), 0);
+    if (data == MAP_FAILED) {
+        free(map);
+        return false;
+    }
+
+    *map = (RegionMap) { data, (size_t)st.st_size, 1 };
+    unmap_region(region);
+    region->map = map;
     return true;
+#else
+    (void)region;
+    (void)size;
+    return false;
+#endif
 }
 
-ChunkLoadStatus world_manager_load_chunk(Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
-    if (!currentWorldDir) return false;
+static void close_region(RegionFile* region) {
+    if (!region->file) return;
+    commit_region(region);
+    unmap_region(region);
+    fclose(region->file);
+    region->file = NULL;
+}
+
+static bool commit_all_regions() {
+    bool ok = true;
+    worker_mutex_lock(regionMutex);
+    for (int i = 0; i < MAX_OPEN_REGIONS; i++) {
+        if (!commit_region(&openRegions[i])) ok = false;
+    }
+    worker_mutex_unlock(regionMutex);
+    return ok;
+}
+
+static void close_all_regions() {
+    worker_mutex_lock(regionMutex);
+    for (int i = 0; i < MAX_OPEN_REGIONS; i++) close_region(&openRegions[i]);
+    worker_mutex_unlock(regionMutex);
+}
+
+// Returns the region of the chunk if it's already open, without opening it or counting it as used.
+// Must be called while holding the lock.
+static RegionFile* find_open_region(const char* worldDir, Vector2i chunkPosition) {
+    Vector2i position = { floor_div(chunkPosition.x, REGION_WIDTH), floor_div(chunkPosition.y, REGION_WIDTH) };
+
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s/regions", worldDir);
 
-    FILE* fptr = fopen(TextFormat("%s/chunks/%d_%d.bin", currentWorldDir, position.x, position.y), "rb");
+    for (int i = 0; i < MAX_OPEN_REGIONS; i++) {
+        RegionFile* region = &openRegions[i];
+        if (region->file && region->position.x == position.x && region->position.y == position.y && strcmp(region->directory, dir) == 0) return region;
+    }
+    return NULL;
+}
+
+// Returns the open region that has the chunk, opening it if needed. Must be called while holding the lock.
+// When create is false and the region doesn't exist, it returns NULL with errno set to ENOENT.
+static RegionFile* get_region(const char* worldDir, Vector2i chunkPosition, bool create) {
+    Vector2i position = { floor_div(chunkPosition.x, REGION_WIDTH), floor_div(chunkPosition.y, REGION_WIDTH) };
+
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s/regions", worldDir);
+
+    // The storage benchmark uses regions in another directory, so the position alone isn't enough
+    RegionFile* slot = &openRegions[0];
+    for (int i = 0; i < MAX_OPEN_REGIONS; i++) {
+        RegionFile* region = &openRegions[i];
+        if (region->file && region->position.x == position.x && region->position.y == position.y && strcmp(region->directory, dir) == 0) {
+            region->lastUse = ++regionUseCounter;
+            return region;
+        }
+        // Reuse a free slot, or the least recently used one
+        if (!region->file || (slot->file && region->lastUse < slot->lastUse)) slot = region;
+    }
+
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%d_%d.bin", dir, position.x, position.y);
+
+    FILE* fptr = fopen(path, "rb+");
+    bool isNew = false;
+    if (!fptr) {
+        if (errno != ENOENT || !create) return NULL;
+        if (!DirectoryExists(dir) && MakeDirectory(dir) != 0) return NULL;
+
+        fptr = fopen(path, "wb+");
+        if (!fptr) return NULL;
+        isNew = true;
+    }
+
+    // Records are always read and written whole, so going through the stdio buffer would only add a copy
+    setvbuf(fptr, NULL, _IONBF, 0);
+
+    close_region(slot);
+    slot->position = position;
+    slot->file = fptr;
+    slot->lastUse = ++regionUseCounter;
+    memset(slot->pending, 0, sizeof(slot->pending));
+    slot->pendingCount = 0;
+    slot->created = isNew;
+    memcpy(slot->directory, dir, sizeof(dir));
+
+    if (isNew) {
+        memset(slot->entries, 0, sizeof(slot->entries));
+
+        // The header takes whole sectors too, so every record starts aligned
+        uint8_t* zeros = calloc(REGION_HEADER_SECTORS, REGION_SECTOR_SIZE);
+        size_t written = zeros ? fwrite(zeros, REGION_SECTOR_SIZE, REGION_HEADER_SECTORS, fptr) : 0;
+        free(zeros);
+        if (written != REGION_HEADER_SECTORS) {
+            close_region(slot);
+            return NULL;
+        }
+    }
+    else if (fread(slot->entries, sizeof(RegionEntry), REGION_CHUNK_COUNT, fptr) != REGION_CHUNK_COUNT) {
+        TraceLog(LOG_ERROR, "The header of region (%d, %d) is corrupted.", position.x, position.y);
+        close_region(slot);
+        errno = EIO;
+        return NULL;
+    }
+
+    return slot;
+}
+
+static uint32_t sector_count(uint32_t length) {
+    return (length + REGION_SECTOR_SIZE - 1) / REGION_SECTOR_SIZE;
+}
+
+// Finds where a record of the given length can go. The sectors of committed records are never reused
+// before the table stops pointing to them, but a pending record of the chunk can be replaced if it still fits.
+static uint32_t find_region_sectors(RegionFile* region, int index, uint32_t length) {
+    uint32_t needed = sector_count(length);
+    RegionEntry* current = &region->pending[index];
+
+    if (current->sector != 0 && sector_count(current->length) >= needed) {
+        return current->sector;
+    }
+
+    uint32_t sectorCount = REGION_HEADER_SECTORS;
+    for (int i = 0; i < REGION_CHUNK_COUNT * 2; i++) {
+        RegionEntry* e = (i < REGION_CHUNK_COUNT) ? &region->entries[i] : &region->pending[i - REGION_CHUNK_COUNT];
+        if (e->sector == 0) continue;
+        uint32_t end = e->sector + sector_count(e->length);
+        if (end > sectorCount) sectorCount = end;
+    }
+
+    // Mark the sectors that are in use, and take the first gap that is big enough (or the end of the file)
+    uint8_t* used = calloc(sectorCount, 1);
+    if (!used) return sectorCount;
+
+    for (int i = 0; i < REGION_CHUNK_COUNT * 2; i++) {
+        RegionEntry* e = (i < REGION_CHUNK_COUNT) ? &region->entries[i] : &region->pending[i - REGION_CHUNK_COUNT];
+        if (e->sector == 0 || e == current) continue;
+        uint32_t count = sector_count(e->length);
+        for (uint32_t s = 0; s < count; s++) used[e->sector + s] = 1;
+    }
+
+    uint32_t start = REGION_HEADER_SECTORS;
+    uint32_t run = 0;
+    for (uint32_t s = REGION_HEADER_SECTORS; s < sectorCount; s++) {
+        if (used[s]) {
+            run = 0;
+            start = s + 1;
+            continue;
+        }
+        if (++run >= needed) break;
+    }
+
+    free(used);
+    return start;
+}
+
+static bool write_record_to_region(const char* worldDir, Vector2i position, const uint8_t* record, size_t size) {
+    worker_mutex_lock(regionMutex);
+
+    RegionFile* region = get_region(worldDir, position, true);
+    if (!region) {
+        TraceLog(LOG_ERROR, "Could not open the region of chunk (%d, %d): %s", position.x, position.y, strerror(errno));
+        worker_mutex_unlock(regionMutex);
+        return false;
+    }
+
+    int index = region_chunk_index(position);
+    uint32_t sector = find_region_sectors(region, index, (uint32_t)size);
+
+    // A record past the end of the file leaves the gap before it filled with zeros
+    bool ok = fseek(region->file, (long)sector * REGION_SECTOR_SIZE, SEEK_SET) == 0
+        && fwrite(record, 1, size, region->file) == size;
+
+    // The table only points to the record once it is committed
+    if (ok) {
+        if (region->pending[index].sector == 0) region->pendingCount++;
+        region->pending[index] = (RegionEntry) { sector, (uint32_t)size };
+    }
+
+    if (!ok) TraceLog(LOG_ERROR, "Could not save chunk at position (%d, %d): %s", position.x, position.y, strerror(errno));
+
+    worker_mutex_unlock(regionMutex);
+    return ok;
+}
+
+static bool save_chunk_to_region(const char* worldDir, Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    byte_writer_clear(&recordWriter);
+    write_chunk_record(&recordWriter, layers);
+
+    if (recordWriter.failed) {
+        TraceLog(LOG_ERROR, "Could not serialize chunk at position (%d, %d).", position.x, position.y);
+        return false;
+    }
+
+    return write_record_to_region(worldDir, position, recordWriter.data, recordWriter.size);
+}
+
+static ChunkLoadStatus load_chunk_from_region(const char* worldDir, Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    worker_mutex_lock(regionMutex);
+
+    RegionFile* region = get_region(worldDir, position, false);
+    if (!region) {
+        worker_mutex_unlock(regionMutex);
+        if (errno != ENOENT) {
+            TraceLog(LOG_ERROR, "Could not read the region of chunk (%d, %d): %s", position.x, position.y, strerror(errno));
+            return CHUNK_LOAD_ERROR_FATAL;
+        }
+        return CHUNK_LOAD_ERROR_NOT_FOUND;
+    }
+
+    int index = region_chunk_index(position);
+    RegionEntry entry = region->pending[index].sector != 0 ? region->pending[index] : region->entries[index];
+    if (entry.sector == 0) {
+        worker_mutex_unlock(regionMutex);
+        return CHUNK_LOAD_ERROR_NOT_FOUND;
+    }
+
+    size_t offset = (size_t)entry.sector * REGION_SECTOR_SIZE;
+
+    // The record is decoded straight from the mapped pages, after letting go of the lock so other workers
+    // can read meanwhile. The sectors of the record aren't written while the chunk is loading, since only
+    // loaded chunks are saved, and the reference keeps them mapped even if the region is closed.
+    if (map_region(region, offset + entry.length)) {
+        RegionMap* map = region->map;
+        map->refs++;
+        worker_mutex_unlock(regionMutex);
+
+        ByteReader reader = byte_reader_create(map->data + offset, entry.length);
+        ChunkLoadStatus status = read_chunk_record(&reader, position, layers);
+
+        worker_mutex_lock(regionMutex);
+        release_region_map(map);
+        worker_mutex_unlock(regionMutex);
+        return status;
+    }
+
+    uint8_t* buffer = malloc(entry.length);
+    bool ok = buffer
+        && fseek(region->file, (long)offset, SEEK_SET) == 0
+        && fread(buffer, 1, entry.length, region->file) == entry.length;
+
+    // The record is parsed after letting go of the lock, so other workers can read meanwhile
+    worker_mutex_unlock(regionMutex);
+
+    if (!ok) {
+        TraceLog(LOG_ERROR, "Could not read chunk at position (%d, %d).", position.x, position.y);
+        free(buffer);
+        return CHUNK_LOAD_ERROR_FATAL;
+    }
+
+    ByteReader reader = byte_reader_create(buffer, entry.length);
+    ChunkLoadStatus status = read_chunk_record(&reader, position, layers);
+    free(buffer);
+    return status;
+}
+
+// Builds the chunk index from the headers of every region file of the world.
+static void rebuild_chunk_index(const char* worldDir) {
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s/regions", worldDir);
+    if (!DirectoryExists(dir)) return;
+
+    FilePathList list = LoadDirectoryFiles(dir);
+    RegionEntry* entries = malloc(sizeof(RegionEntry) * REGION_CHUNK_COUNT);
+    int chunkCount = 0;
+
+    for (unsigned int i = 0; entries && i < list.count; i++) {
+        Vector2i region;
+        if (sscanf(GetFileName(list.paths[i]), "%d_%d.bin", &region.x, &region.y) != 2) continue;
+
+        FILE* fptr = fopen(list.paths[i], "rb");
+        if (!fptr) continue;
+        size_t read = fread(entries, sizeof(RegionEntry), REGION_CHUNK_COUNT, fptr);
+        fclose(fptr);
+
+        // A broken header can't say which chunks are missing, so it's left out and its chunks are read from the region
+        if (read != REGION_CHUNK_COUNT) {
+            TraceLog(LOG_WARNING, "Could not index region (%d, %d), its header is corrupted.", region.x, region.y);
+            continue;
+        }
+
+        for (int c = 0; c < REGION_CHUNK_COUNT; c++) {
+            if (entries[c].sector == 0) continue;
+            index_chunk((Vector2i) { region.x * REGION_WIDTH + c % REGION_WIDTH, region.y * REGION_WIDTH + c / REGION_WIDTH });
+            chunkCount++;
+        }
+    }
+
+    free(entries);
+    UnloadDirectoryFiles(list);
+    TraceLog(LOG_INFO, "Indexed %d saved chunks of %s.", chunkCount, worldDir);
+}
+
+// The index file is:
+//
+//     uint32 region count, then (int32 x, int32 y, one bit per chunk of the region) for every region
+//
+// It is only written when the world is closed, and removed as soon as it's read, so if the game
+// crashes the world has no index and it's built again from the region headers.
+// A world that is only read keeps its index file, since nothing it does can make the index wrong.
+static void load_chunk_index(const char* worldDir, bool readOnly) {
+    clear_chunk_index();
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/regions/index.bin", worldDir);
+
+    FILE* fptr = fopen(path, "rb");
+    if (!fptr) {
+        rebuild_chunk_index(worldDir);
+        return;
+    }
+
+    uint32_t count = 0;
+    bool ok = fread(&count, sizeof(uint32_t), 1, fptr) == 1;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        Vector2i region;
+        ok = fread(&region, sizeof(Vector2i), 1, fptr) == 1;
+
+        ChunkIndexEntry* entry = ok ? get_index_entry(region, true) : NULL;
+        ok = entry && fread(entry->saved, sizeof(entry->saved), 1, fptr) == 1;
+    }
+    fclose(fptr);
+    if (!readOnly) remove(path);
+
+    if (!ok) {
+        TraceLog(LOG_WARNING, "The chunk index of %s is corrupted, building it again.", worldDir);
+        clear_chunk_index();
+        rebuild_chunk_index(worldDir);
+    }
+}
+
+static void save_chunk_index(const char* worldDir) {
+    // Nothing was ever saved, so there might not even be a regions directory
+    if (!chunkIndex) return;
+
+    ByteWriter writer = { 0 };
+    byte_writer_write_u32(&writer, HASH_COUNT(chunkIndex));
+
+    ChunkIndexEntry *entry, *tmp;
+    HASH_ITER(hh, chunkIndex, entry, tmp) {
+        byte_writer_write(&writer, &entry->position, sizeof(Vector2i));
+        byte_writer_write(&writer, entry->saved, sizeof(entry->saved));
+    }
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/regions/index.bin", worldDir);
+
+    // A partial index would hide chunks that are saved, so it's written whole or not at all
+    if (writer.failed || !write_file_atomic(path, writer.data, writer.size)) {
+        TraceLog(LOG_WARNING, "Could not save the chunk index (%s): %s", path, strerror(errno));
+    }
+    byte_writer_free(&writer);
+}
+
+// Chunks used to be saved in a file each, inside the chunks directory.
+static ChunkLoadStatus load_legacy_chunk(const char* path, Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    FILE* fptr = fopen(path, "rb");
     if (!fptr) {
         if (errno != ENOENT) {
             TraceLog(LOG_ERROR, "Could not read chunk at position (%d, %d): %s", position.x, position.y, strerror(errno));
@@ -298,41 +1060,356 @@ ChunkLoadStatus world_manager_load_chunk(Vector2i position, ChunkLayer layers[CH
         return CHUNK_LOAD_ERROR_NOT_FOUND;
     }
 
-    uint8_t version;
-    fread(&version, sizeof(uint8_t), 1, fptr);
-    if (version != WORLD_VERSION) {
-        TraceLog(LOG_ERROR, "Refused to load chunk (%d, %d) because its saved in a different version.\nChunk version: %d\nCurrent version: %d", position.x, position.y, version, WORLD_VERSION);
+    fseek(fptr, 0, SEEK_END);
+    long size = ftell(fptr);
+    fseek(fptr, 0, SEEK_SET);
+
+    uint8_t* buffer = size > 0 ? malloc(size) : NULL;
+    bool ok = buffer && fread(buffer, 1, size, fptr) == (size_t)size;
+    fclose(fptr);
+
+    if (!ok) {
+        TraceLog(LOG_ERROR, "Could not read chunk at position (%d, %d).", position.x, position.y);
+        free(buffer);
         return CHUNK_LOAD_ERROR_FATAL;
     }
 
-    for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
-        for (int b = 0; b < CHUNK_AREA; b++) {
-			fread(&layers[l].blocks[b].id, sizeof(uint8_t), 1, fptr);
-            fread(&layers[l].blocks[b].state, sizeof(uint8_t), 1, fptr);
-            uint32_t dataOffset = 0;
-            fread(&dataOffset, sizeof(uint32_t), 1, fptr);
-            if (dataOffset != 0) {
-                long currentPos = ftell(fptr);
-                fseek(fptr, dataOffset, SEEK_SET);
-                BlockRegistry* reg = br_get_block_registry(layers[l].blocks[b].id);
-                if (reg && reg->data_deserializer) {
-                    layers[l].blocks[b].data = reg->data_deserializer(fptr);
-                }
-                fseek(fptr, currentPos, SEEK_SET);
-            } else {
-                layers[l].blocks[b].data = NULL;
-			}
+    ByteReader reader = byte_reader_create(buffer, size);
+    ChunkLoadStatus status = read_chunk_record(&reader, position, layers);
+    free(buffer);
+    return status;
+}
+
+static void save_legacy_chunk(const char* path, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    FILE* fptr = fopen(path, "wb");
+    if (!fptr) return;
+
+    byte_writer_clear(&recordWriter);
+    write_chunk_record(&recordWriter, layers);
+    fwrite(recordWriter.data, 1, recordWriter.size, fptr);
+    fclose(fptr);
+}
+
+bool world_manager_save_chunk(Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    if (!currentWorldDir) return false;
+    if (!save_chunk_to_region(currentWorldDir, position, layers)) return false;
+
+    worker_mutex_lock(regionMutex);
+    index_chunk(position);
+    worker_mutex_unlock(regionMutex);
+    return true;
+}
+
+ChunkLoadStatus world_manager_load_chunk(Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    if (!currentWorldDir) return false;
+    return load_chunk_from_region(currentWorldDir, position, layers);
+}
+
+bool world_manager_serialize_chunk(ChunkLayer layers[CHUNK_LAYER_COUNT], ByteWriter* writer) {
+    byte_writer_clear(writer);
+    write_chunk_record(writer, layers);
+    return !writer->failed;
+}
+
+bool world_manager_write_chunk_record(Vector2i position, const uint8_t* record, size_t size) {
+    if (!currentWorldDir) return false;
+    if (!write_record_to_region(currentWorldDir, position, record, size)) return false;
+
+    worker_mutex_lock(regionMutex);
+    index_chunk(position);
+    worker_mutex_unlock(regionMutex);
+    return true;
+}
+
+bool world_manager_commit_chunks() {
+    return commit_all_regions();
+}
+
+#ifdef REGION_MMAP
+typedef struct {
+    RegionMap* map;
+    size_t start;
+    size_t length;
+} PrefetchRange;
+#endif
+
+void world_manager_prefetch_chunks(Vector2i start, Vector2i end) {
+#ifdef REGION_MMAP
+    if (!currentWorldDir) return;
+
+    if (end.x < start.x || end.y < start.y) return;
+
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t count = 0;
+    PrefetchRange* ranges = malloc(sizeof(PrefetchRange) * (size_t)(end.x - start.x + 1) * (size_t)(end.y - start.y + 1));
+    if (!ranges) return;
+
+    // Only regions that are already open and mapped are looked at. Opening one could close another,
+    // which commits it, and that is way too slow for something that is only a hint.
+    worker_mutex_lock(regionMutex);
+    for (int y = start.y; y <= end.y; y++) {
+        for (int x = start.x; x <= end.x; x++) {
+            Vector2i position = { x, y };
+            int index = region_chunk_index(position);
+
+            RegionFile* region = find_open_region(currentWorldDir, position);
+            if (!region || !region->map) continue;
+
+            RegionEntry entry = region->pending[index].sector != 0 ? region->pending[index] : region->entries[index];
+            size_t offset = (size_t)entry.sector * REGION_SECTOR_SIZE;
+            if (entry.sector == 0 || offset + entry.length > region->map->size) continue;
+
+            size_t pageStart = offset - offset % pageSize;
+            region->map->refs++;
+            ranges[count++] = (PrefetchRange) { region->map, pageStart, offset + entry.length - pageStart };
+        }
+    }
+    worker_mutex_unlock(regionMutex);
+
+    for (size_t i = 0; i < count; i++) {
+        madvise((void*)(ranges[i].map->data + ranges[i].start), ranges[i].length, MADV_WILLNEED);
+    }
+
+    if (count > 0) {
+        worker_mutex_lock(regionMutex);
+        for (size_t i = 0; i < count; i++) release_region_map(ranges[i].map);
+        worker_mutex_unlock(regionMutex);
+    }
+    free(ranges);
+#else
+    (void)start;
+    (void)end;
+#endif
+}
+
+bool world_manager_has_chunk(Vector2i position) {
+    if (!currentWorldDir) return false;
+
+    Vector2i region = { floor_div(position.x, REGION_WIDTH), floor_div(position.y, REGION_WIDTH) };
+    int index = region_chunk_index(position);
+
+    worker_mutex_lock(regionMutex);
+    ChunkIndexEntry* entry = get_index_entry(region, false);
+    bool saved = entry && (entry->saved[index / 32] & (1u << (index % 32)));
+    worker_mutex_unlock(regionMutex);
+
+    return saved;
+}
+
+ChunkLoadStatus world_manager_deserialize_chunk(Vector2i position, const uint8_t* record, size_t size, ChunkLayer layers[CHUNK_LAYER_COUNT]) {
+    ByteReader reader = byte_reader_create(record, size);
+    return read_chunk_record(&reader, position, layers);
+}
+
+RegionRecord* world_manager_read_region(const char* path, int* count, int* invalidCount) {
+    *count = 0;
+    *invalidCount = 0;
+
+    Vector2i region;
+    if (sscanf(GetFileName(path), "%d_%d.bin", &region.x, &region.y) != 2) return NULL;
+
+    FILE* fptr = fopen(path, "rb");
+    if (!fptr) return NULL;
+
+    fseek(fptr, 0, SEEK_END);
+    long fileSize = ftell(fptr);
+    fseek(fptr, 0, SEEK_SET);
+
+    RegionEntry* entries = malloc(sizeof(RegionEntry) * REGION_CHUNK_COUNT);
+    RegionRecord* records = calloc(REGION_CHUNK_COUNT, sizeof(RegionRecord));
+    if (!entries || !records || fread(entries, sizeof(RegionEntry), REGION_CHUNK_COUNT, fptr) != REGION_CHUNK_COUNT) {
+        free(entries);
+        free(records);
+        fclose(fptr);
+        return NULL;
+    }
+
+    for (int i = 0; i < REGION_CHUNK_COUNT; i++) {
+        RegionEntry entry = entries[i];
+        if (entry.sector == 0) continue;
+
+        // Pointing into the table or past the end of the file can only mean the table is broken
+        size_t offset = (size_t)entry.sector * REGION_SECTOR_SIZE;
+        if (entry.sector < REGION_HEADER_SECTORS || entry.length == 0 || offset + entry.length > (size_t)fileSize) {
+            (*invalidCount)++;
+            continue;
+        }
+
+        RegionRecord* record = &records[*count];
+        record->position = (Vector2i) { region.x * REGION_WIDTH + i % REGION_WIDTH, region.y * REGION_WIDTH + i / REGION_WIDTH };
+        record->size = entry.length;
+        record->data = malloc(entry.length);
+
+        if (!record->data
+            || fseek(fptr, (long)offset, SEEK_SET) != 0
+            || fread(record->data, 1, entry.length, fptr) != entry.length) {
+            free(record->data);
+            record->data = NULL;
+            (*invalidCount)++;
+            continue;
         }
+        (*count)++;
     }
 
+    free(entries);
     fclose(fptr);
+    return records;
+}
 
-    return CHUNK_LOAD_SUCCESS;
+void world_manager_free_region_records(RegionRecord* records, int count) {
+    if (!records) return;
+    for (int i = 0; i < count; i++) free(records[i].data);
+    free(records);
+}
+
+bool world_manager_write_region(const char* path, const RegionRecord* records, int count) {
+    RegionEntry* entries = calloc(REGION_CHUNK_COUNT, sizeof(RegionEntry));
+    if (!entries) return false;
+
+    // The records are packed right after the table, in the order they come
+    uint32_t sector = REGION_HEADER_SECTORS;
+    for (int i = 0; i < count; i++) {
+        int index = region_chunk_index(records[i].position);
+        entries[index] = (RegionEntry) { sector, (uint32_t)records[i].size };
+        sector += sector_count((uint32_t)records[i].size);
+    }
+
+    ByteWriter writer = { 0 };
+    byte_writer_write(&writer, entries, sizeof(RegionEntry) * REGION_CHUNK_COUNT);
+    for (int i = 0; i < count; i++) {
+        int index = region_chunk_index(records[i].position);
+        uint8_t zeros[REGION_SECTOR_SIZE] = { 0 };
+
+        byte_writer_write(&writer, zeros, (size_t)entries[index].sector * REGION_SECTOR_SIZE - writer.size);
+        byte_writer_write(&writer, records[i].data, records[i].size);
+    }
+    free(entries);
+
+    bool ok = !writer.failed && write_file_atomic(path, writer.data, writer.size);
+    byte_writer_free(&writer);
+    return ok;
+}
+
+int world_manager_convert_legacy_chunks(const char* worldDir) {
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s/chunks", worldDir);
+    if (!DirectoryExists(dir)) return 0;
+
+    FilePathList list = LoadDirectoryFiles(dir);
+    bool* saved = calloc(list.count, sizeof(bool));
+    if (list.count > 0 && !saved) {
+        UnloadDirectoryFiles(list);
+        return 0;
+    }
+
+    for (unsigned int i = 0; i < list.count; i++) {
+        Vector2i position;
+        if (sscanf(GetFileName(list.paths[i]), "%d_%d.bin", &position.x, &position.y) != 2) continue;
+
+        ChunkLayer layers[CHUNK_LAYER_COUNT];
+        memset(layers, 0, sizeof(layers));
+
+        if (load_legacy_chunk(list.paths[i], position, layers) != CHUNK_LOAD_SUCCESS) {
+            TraceLog(LOG_WARNING, "Could not convert chunk (%d, %d), its file was left in place.", position.x, position.y);
+            for (int l = 0; l < CHUNK_LAYER_COUNT; l++) chunk_layer_free_block_data(&layers[l]);
+            continue;
+        }
+
+        saved[i] = save_chunk_to_region(worldDir, position, layers);
+        for (int l = 0; l < CHUNK_LAYER_COUNT; l++) chunk_layer_free_block_data(&layers[l]);
+    }
+
+    // The old files only go away once their chunks are committed to the regions
+    int converted = 0;
+    if (commit_all_regions()) {
+        for (unsigned int i = 0; i < list.count; i++) {
+            if (!saved[i]) continue;
+            remove(list.paths[i]);
+            converted++;
+        }
+    }
+
+    free(saved);
+    UnloadDirectoryFiles(list);
+    // Only goes away if every chunk was converted
+    remove(dir);
+
+    if (converted > 0) TraceLog(LOG_INFO, "Converted %d chunks of %s to region files.", converted, worldDir);
+    return converted;
+}
+
+void world_manager_benchmark_storage(ChunkLayer (*layers)[CHUNK_LAYER_COUNT], int count) {
+    if (!currentWorldDir || count <= 0) return;
+
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s/benchmark", currentWorldDir);
+    if (!DirectoryExists(dir) && MakeDirectory(dir) != 0) {
+        TraceLog(LOG_ERROR, "Could not create the benchmark directory: %s", strerror(errno));
+        return;
+    }
+
+    // The chunks are repeated at made up positions until they fill a whole region
+    int total = REGION_CHUNK_COUNT;
+    ChunkLayer* loaded = malloc(sizeof(ChunkLayer) * CHUNK_LAYER_COUNT);
+    if (!loaded) return;
+
+    // Longer than dir, so the file names always fit after it
+    char path[600];
+    size_t recordBytes = 0;
+    double start = GetTime();
+    for (int i = 0; i < total; i++) {
+        snprintf(path, sizeof(path), "%s/%d_%d.bin", dir, i % REGION_WIDTH, i / REGION_WIDTH);
+        save_legacy_chunk(path, layers[i % count]);
+        recordBytes += recordWriter.size;
+    }
+    double legacySave = GetTime() - start;
+
+    start = GetTime();
+    for (int i = 0; i < total; i++) {
+        snprintf(path, sizeof(path), "%s/%d_%d.bin", dir, i % REGION_WIDTH, i / REGION_WIDTH);
+        memset(loaded, 0, sizeof(ChunkLayer) * CHUNK_LAYER_COUNT);
+        load_legacy_chunk(path, (Vector2i) { i % REGION_WIDTH, i / REGION_WIDTH }, loaded);
+        for (int l = 0; l < CHUNK_LAYER_COUNT; l++) chunk_layer_free_block_data(&loaded[l]);
+        remove(path);
+    }
+    double legacyLoad = GetTime() - start;
+
+    start = GetTime();
+    for (int i = 0; i < total; i++) {
+        save_chunk_to_region(dir, (Vector2i) { i % REGION_WIDTH, i / REGION_WIDTH }, layers[i % count]);
+    }
+    commit_all_regions();
+    double regionSave = GetTime() - start;
+
+    start = GetTime();
+    for (int i = 0; i < total; i++) {
+        memset(loaded, 0, sizeof(ChunkLayer) * CHUNK_LAYER_COUNT);
+        load_chunk_from_region(dir, (Vector2i) { i % REGION_WIDTH, i / REGION_WIDTH }, loaded);
+        for (int l = 0; l < CHUNK_LAYER_COUNT; l++) chunk_layer_free_block_data(&loaded[l]);
+    }
+    double regionLoad = GetTime() - start;
+
+    free(loaded);
+
+    // The benchmark regions have to be closed before their files can go away
+    close_all_regions();
+    snprintf(path, sizeof(path), "%s/regions/0_0.bin", dir);
+    remove(path);
+    snprintf(path, sizeof(path), "%s/regions", dir);
+    remove(path);
+    remove(dir);
+
+    TraceLog(LOG_INFO, "Storage benchmark (%d chunks, %zu bytes per chunk on average):", total, recordBytes / total);
+    TraceLog(LOG_INFO, "    One file per chunk: save %.0f chunks/s, load %.0f chunks/s", total / legacySave, total / legacyLoad);
+    TraceLog(LOG_INFO, "    Region files: save %.0f chunks/s, load %.0f chunks/s", total / regionSave, total / regionLoad);
 }
 
 bool world_manager_save_world_info_and_unload() {
     if (!currentWorldDir) return false;
     bool saved = world_manager_save_world_info();
+    close_all_regions();
+    save_chunk_index(currentWorldDir);
+    clear_chunk_index();
     if (currentWorldDir) {
         free(currentWorldDir);
         currentWorldDir = NULL;
@@ -351,6 +1428,12 @@ void world_manager_free() {
         worldListCount = 0;
     }
     if (currentWorldDir) free(currentWorldDir);
+
+    close_all_regions();
+    clear_chunk_index();
+    byte_writer_free(&recordWriter);
+    worker_mutex_destroy(regionMutex);
+    regionMutex = NULL;
 }
 
 WorldInfo* get_world_info() {
@@ -361,6 +1444,10 @@ bool world_manager_is_world_loaded() {
 	return currentWorldDir != NULL;
 }
 
+const char* world_manager_get_world_dir() {
+    return currentWorldDir;
+}
+
 bool world_manager_load_world_list() {
     if (selectedEntry) selectedEntry->selected = false;
     selectedEntry = NULL;
@@ -0,0 +1,257 @@
+// Offline tool that goes through every chunk of a world without opening a window.
+// It checks that every chunk record can be read, writes them again with the current encoding,
+// and drops the chunks that are the same as what the world generator makes for them.
+//
+// Usage: world_tool <world name or directory> [--check] [--keep-generated]
+//
+//     --check           only check the chunks and report, without writing anything to the world
+//                       (chunks of older versions aren't converted to region files, so they are only counted)
+//     --keep-generated  keep the chunks that are the same as the generated ones
+//
+// The world must not be open in the game while the tool runs.
+
+#include "world_manager.h"
+#include "worker_pool.h"
+#include "chunk.h"
+#include "registries/block_models.h"
+#include "registries/block_registry.h"
+#include "registries/item_registry.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <raylib.h>
+
+typedef struct {
+    int chunks;
+    // Records that can't be read. They are kept as they are, so nothing is lost.
+    int corrupted;
+    // Chunks that are the same as the generated ones, which are dropped
+    int generated;
+    size_t recordBytesBefore;
+    size_t recordBytesAfter;
+    long fileBytesBefore;
+    long fileBytesAfter;
+} WorldToolStats;
+
+// Every region is a job, so a world is spread across all the cores
+typedef struct {
+    char path[512];
+    bool check;
+    bool keepGenerated;
+    bool failed;
+    WorldToolStats stats;
+} RegionJob;
+
+static WorldToolStats totals = { 0 };
+static int failedRegions = 0;
+
+// Chunks of older versions, one file per chunk, that haven't been converted to region files yet
+static int count_legacy_chunks(const char* worldDir) {
+    char dir[600];
+    snprintf(dir, sizeof(dir), "%s/chunks", worldDir);
+    if (!DirectoryExists(dir)) return 0;
+
+    FilePathList list = LoadDirectoryFiles(dir);
+    int count = 0;
+    for (unsigned int i = 0; i < list.count; i++) {
+        int x, y;
+        if (sscanf(GetFileName(list.paths[i]), "%d_%d.bin", &x, &y) == 2) count++;
+    }
+    UnloadDirectoryFiles(list);
+    return count;
+}
+
+static bool is_generated(Vector2i position, ChunkLayer layers[CHUNK_LAYER_COUNT], Chunk* generated) {
+    memset(generated, 0, sizeof(Chunk));
+    generated->position = position;
+    chunk_regenerate(generated);
+
+    for (int l = 0; l < CHUNK_LAYER_COUNT; l++) {
+        if (layers[l].dataCount > 0) return false;
+        if (memcmp(layers[l].ids, generated->layers[l].ids, sizeof(layers[l].ids)) != 0) return false;
+        if (memcmp(layers[l].states, generated->layers[l].states, sizeof(layers[l].states)) != 0) return false;
+    }
+    return true;
+}
+
+// Runs on a worker thread
+static void region_job_work(void* data) {
+    RegionJob* job = data;
+
+    int count, invalid;
+    RegionRecord* records = world_manager_read_region(job->path, &count, &invalid);
+    if (!records) {
+        TraceLog(LOG_ERROR, "Could not read region file %s.", job->path);
+        job->failed = true;
+        return;
+    }
+
+    job->stats.fileBytesBefore = GetFileLength(job->path);
+    job->stats.chunks = count + invalid;
+    job->stats.corrupted = invalid;
+    if (invalid > 0) TraceLog(LOG_WARNING, "%s: %d chunk entries point outside of the file, they are dropped.", job->path, invalid);
+
+    Chunk* generated = malloc(sizeof(Chunk));
+    ChunkLayer* layers = malloc(sizeof(ChunkLayer) * CHUNK_LAYER_COUNT);
+    ByteWriter writer = { 0 };
+    if (!generated || !layers) {
+        TraceLog(LOG_ERROR, "Could not allocate memory for region %s.", job->path);
+        free(generated);
+        free(layers);
+        world_manager_free_region_records(records, count);
+        job->failed = true;
+        return;
+    }
+
+    int kept = 0;
+    for (int r = 0; r < count; r++) {
+        RegionRecord record = records[r];
+        job->stats.recordBytesBefore += record.size;
+
+        memset(layers, 0, sizeof(ChunkLayer) * CHUNK_LAYER_COUNT);
+        ChunkLoadStatus status = world_manager_deserialize_chunk(record.position, record.data, record.size, layers);
+
+        if (status != CHUNK_LOAD_SUCCESS) {
+            TraceLog(LOG_WARNING, "%s: chunk (%d, %d) is corrupted or from a newer version, it is kept as it is.", job->path, record.position.x, record.position.y);
+            job->stats.corrupted++;
+        }
+        else if (!job->keepGenerated && is_generated(record.position, layers, generated)) {
+            job->stats.generated++;
+            free(record.data);
+            record.data = NULL;
+        }
+        else if (world_manager_serialize_chunk(layers, &writer)) {
+            uint8_t* encoded = malloc(writer.size);
+            if (encoded) {
+                memcpy(encoded, writer.data, writer.size);
+                free(record.data);
+                record.data = encoded;
+                record.size = writer.size;
+            }
+        }
+
+        for (int l = 0; l < CHUNK_LAYER_COUNT; l++) chunk_layer_free_block_data(&layers[l]);
+
+        if (!record.data) continue;
+        job->stats.recordBytesAfter += record.size;
+        records[kept++] = record;
+    }
+
+    byte_writer_free(&writer);
+    free(layers);
+    free(generated);
+
+    if (!job->check) {
+        bool ok = true;
+        if (kept > 0) ok = world_manager_write_region(job->path, records, kept);
+        else ok = remove(job->path) == 0;
+
+        if (!ok) {
+            TraceLog(LOG_ERROR, "Could not write region file %s, it was left as it was.", job->path);
+            job->failed = true;
+        }
+        job->stats.fileBytesAfter = kept > 0 ? GetFileLength(job->path) : 0;
+    }
+
+    world_manager_free_region_records(records, kept);
+}
+
+// Runs on the main thread
+static void region_job_done(void* data) {
+    RegionJob* job = data;
+
+    if (job->failed) failedRegions++;
+    totals.chunks += job->stats.chunks;
+    totals.corrupted += job->stats.corrupted;
+    totals.generated += job->stats.generated;
+    totals.recordBytesBefore += job->stats.recordBytesBefore;
+    totals.recordBytesAfter += job->stats.recordBytesAfter;
+    totals.fileBytesBefore += job->stats.fileBytesBefore;
+    totals.fileBytesAfter += job->stats.fileBytesAfter;
+
+    free(job);
+}
+
+int main(int argc, char** argv) {
+    const char* world = NULL;
+    bool check = false;
+    bool keepGenerated = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0) check = true;
+        else if (strcmp(argv[i], "--keep-generated") == 0) keepGenerated = true;
+        else world = argv[i];
+    }
+
+    if (!world) {
+        printf("Usage: %s <world name or directory> [--check] [--keep-generated]\n", argv[0]);
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    block_models_init();
+    item_registry_init();
+    block_registry_init();
+    world_manager_init();
+
+    char worldDir[512];
+    snprintf(worldDir, sizeof(worldDir), DirectoryExists(world) ? "%s" : "worlds/%s", world);
+
+    // Loading the world info refuses newer worlds, and converts the chunks of older ones unless only checking
+    if (!(check ? world_manager_load_world_info_read_only(worldDir) : world_manager_load_world_info(worldDir))) return 1;
+    int legacyChunks = check ? count_legacy_chunks(worldDir) : 0;
+
+    char regionsDir[600];
+    snprintf(regionsDir, sizeof(regionsDir), "%s/regions", worldDir);
+
+    FilePathList list = DirectoryExists(regionsDir) ? LoadDirectoryFiles(regionsDir) : (FilePathList) { 0 };
+
+    WorkerPool* pool = worker_pool_create(0);
+    double start = GetTime();
+    int regionCount = 0;
+
+    for (unsigned int i = 0; i < list.count; i++) {
+        int x, y;
+        const char* extension = GetFileExtension(list.paths[i]);
+        if (!extension || strcmp(extension, ".bin") != 0) continue;
+        if (sscanf(GetFileName(list.paths[i]), "%d_%d.bin", &x, &y) != 2) continue;
+
+        RegionJob* job = calloc(1, sizeof(RegionJob));
+        if (!job) continue;
+        snprintf(job->path, sizeof(job->path), "%s", list.paths[i]);
+        job->check = check;
+        job->keepGenerated = keepGenerated;
+        regionCount++;
+
+        if (!pool || !worker_pool_submit(pool, region_job_work, region_job_done, job)) {
+            region_job_work(job);
+            region_job_done(job);
+        }
+    }
+
+    if (pool) worker_pool_destroy(pool);
+    if (list.count > 0) UnloadDirectoryFiles(list);
+
+    double elapsed = GetTime() - start;
+
+    // The chunk index has to be built again to leave out the dropped chunks.
+    // When only checking, the world is closed without saving anything.
+    if (!check) {
+        world_manager_save_world_info_and_unload();
+        remove(TextFormat("%s/index.bin", regionsDir));
+    }
+    world_manager_free();
+
+    printf("%s: %d regions, %d chunks in %.2f s\n", worldDir, regionCount, totals.chunks, elapsed);
+    printf("    corrupted: %d\n", totals.corrupted);
+    printf("    same as generated: %d%s\n", totals.generated, keepGenerated ? "" : (check ? " (would be dropped)" : " (dropped)"));
+    printf("    chunk records: %zu -> %zu bytes\n", totals.recordBytesBefore, totals.recordBytesAfter);
+    if (!check) printf("    region files: %ld -> %ld bytes\n", totals.fileBytesBefore, totals.fileBytesAfter);
+    if (legacyChunks > 0) printf("    old chunk files: %d (not checked, they are converted when the world is opened)\n", legacyChunks);
+    if (failedRegions > 0) printf("    %d regions could not be processed\n", failedRegions);
+
+    return (failedRegions > 0 || totals.corrupted > 0) ? 2 : 0;
+}